@@ -0,0 +1,192 @@
+#include "swarm.h"
+#include "random.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+// Benchmark for the BST, AVL and SPLAY tree types. Every combination of
+// tree type, workload, ID distribution and swarm size runs in its own child
+// process, so the peak resident memory reported for it is its own. Results
+// go to stdout as CSV, one row per run:
+//   tree,workload,distribution,robots,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,peak_rss_kb
+// Build: g++ -std=c++17 -O2 -pthread bench.cpp swarm.cpp -o bench
+// Usage: ./bench [ops per run] > results.csv
+
+enum WORKLOAD {INSERTHEAVY, LOOKUPHEAVY, MIXED, CHURN};
+
+const TREETYPE TREES[] = {BST, AVL, SPLAY};
+const char* const TREENAMES[] = {"NONE", "BST", "AVL", "SPLAY"};
+const WORKLOAD WORKLOADS[] = {INSERTHEAVY, LOOKUPHEAVY, MIXED, CHURN};
+const char* const WORKLOADNAMES[] = {"insert-heavy", "lookup-heavy", "mixed", "churn"};
+const RANDOM DISTRIBUTIONS[] = {UNIFORMINT, NORMAL, SHUFFLE, ZIPF, SEQUENTIAL};
+const char* const DISTRIBUTIONNAMES[] = {"uniform", "real", "normal", "shuffle", "zipf", "sequential"};
+const int SIZES[] = {1000, 10000, 90000};
+
+const int DEFAULTOPS = 100000;   // Timed operations per run
+const int LATENCYSTRIDE = 4;     // Every LATENCYSTRIDE-th operation is timed on its own
+const int DEGENERATELIMIT = 10000;  // Largest swarm a BST is filled in ID order, O(n^2) beyond
+
+// Outcome of one run
+struct Result {
+    double m_seconds;         // Wall time of all timed operations
+    long long m_p50;          // Latency percentiles in nanoseconds
+    long long m_p99;
+    long long m_p999;
+};
+
+// Nanoseconds since an arbitrary start
+static long long nanoseconds() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Value at a percentile of the latency samples, which are reordered
+static long long percentile(vector<long long>& samples, double fraction) {
+    size_t k = static_cast<size_t>(fraction * (samples.size() - 1));
+    nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+// Run one workload. IDs are drawn from the distribution over a key space
+// twice the swarm size (capped at MINID..MAXID), so lookups and removals
+// hit about half the time. Except for insert-heavy, the swarm is first
+// filled with that many robots in random order (in ID order for the
+// sequential distribution).
+//   insert-heavy: 90% insert / 10% find, from empty; cleared every robots ops
+//   lookup-heavy: 95% find / 5% insert
+//   mixed:        50% find / 25% insert / 25% remove
+//   churn:        remove then re-insert the same ID with a new type, as one op
+static Result runWorkload(TREETYPE tree, WORKLOAD workload, RANDOM distribution, int robots, int ops) {
+    int keys = min(2 * robots, IDCOUNT);
+    int lastKey = MINID + keys - 1;
+    Random idGen(MINID, lastKey, distribution, MINID + keys / 2, keys / 8);
+    idGen.setSeed(robots + 7 * workload);
+    Random opGen(0, 99);
+    Random typeGen(0, TYPECOUNT - 1);
+    typeGen.setSeed(robots + 1);   // Not in step with opGen, which keeps the fixed seed
+
+    Swarm swarm(tree);
+    if (workload != INSERTHEAVY) {
+        vector<int> order;
+        Random shuffler(MINID, lastKey, SHUFFLE);
+        shuffler.setSeed(robots);
+        shuffler.getShuffle(order);
+        if (distribution == SEQUENTIAL) {
+            sort(order.begin(), order.begin() + robots);
+        }
+        for (int i = 0; i < robots; i++) {
+            swarm.insert(Robot(order[i], static_cast<ROBOTTYPE>(typeGen.getRandNum())));
+        }
+    }
+
+    vector<long long> samples;
+    samples.reserve(ops / LATENCYSTRIDE + 1);
+    long long spent = 0;
+    long long start = nanoseconds();
+    for (int i = 0; i < ops; i++) {
+        if (workload == INSERTHEAVY && i % robots == 0 && i > 0) {
+            long long pause = nanoseconds();
+            swarm.clear();   // Not part of the workload
+            spent += nanoseconds() - pause;
+        }
+        int id = idGen.getRandNum();
+        int dice = opGen.getRandNum();
+        ROBOTTYPE type = static_cast<ROBOTTYPE>(typeGen.getRandNum());
+        bool timed = (i % LATENCYSTRIDE == 0);
+        long long before = timed ? nanoseconds() : 0;
+
+        if (workload == INSERTHEAVY) {
+            if (dice < 90) swarm.insert(Robot(id, type));
+            else swarm.contains(id);
+        } else if (workload == LOOKUPHEAVY) {
+            if (dice < 95) swarm.contains(id);
+            else swarm.insert(Robot(id, type));
+        } else if (workload == MIXED) {
+            if (dice < 50) swarm.contains(id);
+            else if (dice < 75) swarm.insert(Robot(id, type));
+            else swarm.remove(id);
+        } else {
+            swarm.remove(id);
+            swarm.insert(Robot(id, type));
+        }
+
+        if (timed) {
+            samples.push_back(nanoseconds() - before);
+        }
+    }
+    Result result;
+    result.m_seconds = (nanoseconds() - start - spent) / 1e9;
+    result.m_p50 = percentile(samples, 0.50);
+    result.m_p99 = percentile(samples, 0.99);
+    result.m_p999 = percentile(samples, 0.999);
+    return result;
+}
+
+// Run one combination in a child process and print its row with the
+// child's peak resident set size
+static bool runIsolated(TREETYPE tree, WORKLOAD workload, RANDOM distribution, int robots, int ops) {
+    int channel[2];
+    if (pipe(channel) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        return false;
+    }
+    if (child == 0) {
+        close(channel[0]);
+        Result result = runWorkload(tree, workload, distribution, robots, ops);
+        ssize_t sent = write(channel[1], &result, sizeof(result));
+        _exit(sent == sizeof(result) ? 0 : 1);
+    }
+
+    close(channel[1]);
+    Result result;
+    bool received = read(channel[0], &result, sizeof(result)) == sizeof(result);
+    close(channel[0]);
+    int status = 0;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) != child || !received || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return false;
+    }
+    printf("%s,%s,%s,%d,%d,%.6f,%.0f,%lld,%lld,%lld,%ld\n",
+           TREENAMES[tree], WORKLOADNAMES[workload], DISTRIBUTIONNAMES[distribution], robots, ops,
+           result.m_seconds, ops / result.m_seconds, result.m_p50, result.m_p99, result.m_p999,
+           usage.ru_maxrss);
+    fflush(stdout);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int ops = (argc > 1) ? atoi(argv[1]) : DEFAULTOPS;
+    if (ops <= 0) {
+        fprintf(stderr, "usage: %s [ops per run]\n", argv[0]);
+        return 1;
+    }
+
+    printf("tree,workload,distribution,robots,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,peak_rss_kb\n");
+    bool ok = true;
+    for (int robots : SIZES) {
+        for (RANDOM distribution : DISTRIBUTIONS) {
+            for (WORKLOAD workload : WORKLOADS) {
+                for (TREETYPE tree : TREES) {
+                    if (tree == BST && distribution == SEQUENTIAL && robots > DEGENERATELIMIT) {
+                        fprintf(stderr, "skipped BST %s sequential %d: a list of %d robots takes O(n^2)\n",
+                                WORKLOADNAMES[workload], robots, robots);
+                        continue;
+                    }
+                    if (!runIsolated(tree, workload, distribution, robots, ops)) {
+                        fprintf(stderr, "run failed: %s %s %s %d\n", TREENAMES[tree], WORKLOADNAMES[workload],
+                                DISTRIBUTIONNAMES[distribution], robots);
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -1,5 +1,14 @@
 #include "swarm.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 using namespace std;
 
 class Tester {
@@ -131,14 +140,17 @@ public:
         return balancedCheck && isBSTAfterRemovals;
     }
 
-    // Test height correctness after multiple insertions in a Splay tree
+    // Test height correctness after multiple insertions in a Splay tree. Splay
+    // trees do not maintain m_height, so heights are checked after converting
     bool testSplayHeight(Swarm& swarm) {
         swarm.setType(SPLAY);
         for (int i = 1; i <= 10; i++) {
             swarm.insert(Robot(i + MINID));
         }
 
+        swarm.setType(BST);
         bool heightCheck = isHeightCorrect(swarm.m_root);  // Check height correctness
+        swarm.setType(SPLAY);
         
         // Cleanup to avoid memory leak
         swarm.clear();  // Ensure all nodes are freed after the test
@@ -159,7 +171,1116 @@ public:
         return heightCheck;
     }
 
+    // Test that nodes come from the swarm's pool and freed nodes are recycled
+    bool testNodePoolReuse(Swarm& swarm) {
+        for (int i = 1; i <= 10; i++) {
+            swarm.insert(Robot(i + MINID));
+        }
+
+        // Consecutive inserts are carved out of the same slab
+        bool contiguous = true;
+        Robot* prev = findNode(swarm.m_root, 1 + MINID);
+        for (int i = 2; i <= 10; i++) {
+            Robot* node = findNode(swarm.m_root, i + MINID);
+            if (node != prev + 1) contiguous = false;
+            prev = node;
+        }
+
+        // A removed leaf goes back on the free list and is handed out next
+        Robot* freed = findNode(swarm.m_root, 10 + MINID);
+        swarm.remove(10 + MINID);
+        swarm.insert(Robot(20 + MINID));
+        bool reused = (findNode(swarm.m_root, 20 + MINID) == freed);
+
+        swarm.clear();
+        return contiguous && reused;
+    }
+
+    // Test that clear() on a degenerate BST hands every node back to the pool
+    bool testClearDegenerate(Swarm& swarm) {
+        const int teamSize = 2000;
+        for (int i = 0; i < teamSize; i++) {
+            swarm.insert(Robot(i + MINID));  // Sequential IDs build a chain
+        }
+        int slabs = countSlabs(*swarm.m_pool);
+
+        swarm.clear();
+        bool empty = (swarm.m_root == nullptr);
+
+        // Refilling must be served entirely from the recycled nodes
+        for (int i = 0; i < teamSize; i++) {
+            swarm.insert(Robot(i + MINID));
+        }
+        bool recycled = (countSlabs(*swarm.m_pool) == slabs);
+
+        swarm.clear();
+        return empty && recycled && swarm.m_root == nullptr;
+    }
+
+    // Test BST/AVL/SPLAY conversions relink the existing nodes into valid trees
+    bool testTypeConversion(Swarm& swarm) {
+        swarm.setType(BST);
+        for (int i = 1; i <= 1000; i++) {
+            swarm.insert(Robot(i + MINID, static_cast<ROBOTTYPE>(i % 5)));  // Degenerate chain
+        }
+        Robot* node = findNode(swarm.m_root, 500 + MINID);
+        int slabs = countSlabs(*swarm.m_pool);
+
+        // BST -> AVL must rebalance in place
+        swarm.setType(AVL);
+        bool result = isBalanced(swarm.m_root) && isBST(swarm.m_root, nullptr, nullptr)
+                      && isHeightCorrect(swarm.m_root)
+                      && countNodes(swarm.m_root) == 1000
+                      && findNode(swarm.m_root, 500 + MINID) == node
+                      && node->getType() == static_cast<ROBOTTYPE>(500 % 5)
+                      && countSlabs(*swarm.m_pool) == slabs;
+
+        // AVL -> SPLAY -> AVL and AVL -> BST keep every robot
+        swarm.setType(SPLAY);
+        swarm.insert(Robot(2000 + MINID));
+        swarm.setType(AVL);
+        result = result && isBalanced(swarm.m_root) && isHeightCorrect(swarm.m_root)
+                 && countNodes(swarm.m_root) == 1001;
+        swarm.setType(BST);
+        result = result && isBST(swarm.m_root, nullptr, nullptr) && countNodes(swarm.m_root) == 1001;
+
+        swarm.clear();
+        return result;
+    }
+
+    // Test bulk loading sorted and unsorted batches with duplicates
+    bool testBulkLoad(Swarm& swarm) {
+        // A sequential roster must not degenerate into a chain in BST mode
+        const int teamSize = 5000;
+        Robot* roster = new Robot[teamSize + 2];
+        for (int i = 0; i < teamSize; i++) {
+            roster[i] = Robot(i + MINID, BIRD);
+        }
+        swarm.bulkLoad(roster, teamSize);
+        bool result = isBalanced(swarm.m_root) && isBST(swarm.m_root, nullptr, nullptr)
+                      && isHeightCorrect(swarm.m_root) && countNodes(swarm.m_root) == teamSize;
+
+        // An unsorted batch overlapping the tree, with duplicates inside the batch
+        for (int i = 0; i < teamSize; i++) {
+            roster[i] = Robot(MINID + 2 * ((i * 7919) % teamSize), (i < teamSize / 2) ? SUB : REPTILE);
+        }
+        roster[teamSize] = Robot(MAXID, SUB);
+        roster[teamSize + 1] = Robot(MAXID, REPTILE);
+        swarm.bulkLoad(roster, teamSize + 2);
+        result = result && isBalanced(swarm.m_root) && isBST(swarm.m_root, nullptr, nullptr)
+                 && isHeightCorrect(swarm.m_root)
+                 && countNodes(swarm.m_root) == teamSize + teamSize / 2 + 1
+                 && findNode(swarm.m_root, MINID)->getType() == BIRD        // Tree wins
+                 && findNode(swarm.m_root, MAXID)->getType() == SUB;        // First in batch wins
+
+        delete[] roster;
+        swarm.clear();
+        return result;
+    }
+
+    // Test find/contains for present and missing robots, and splaying on lookup
+    bool testFindContains(Swarm& swarm) {
+        for (int i = 1; i <= 100; i++) {
+            swarm.insert(Robot(i * 10 + MINID, static_cast<ROBOTTYPE>(i % 5), (i % 2) ? ALIVE : DEAD));
+        }
+
+        const Robot* robot = swarm.find(420 + MINID);
+        bool result = robot != nullptr && robot->getID() == 420 + MINID
+                      && robot->getType() == static_cast<ROBOTTYPE>(42 % 5) && robot->getState() == DEAD
+                      && swarm.contains(10 + MINID) && swarm.contains(1000 + MINID)
+                      && !swarm.contains(15 + MINID) && !swarm.contains(MAXID)
+                      && swarm.find(MINID) == nullptr;
+
+        // In SPLAY mode a successful lookup moves the robot to the root
+        if (swarm.getType() == SPLAY) {
+            result = result && swarm.find(730 + MINID) == swarm.m_root
+                     && swarm.m_root->getID() == 730 + MINID;
+        }
+        result = result && isBST(swarm.m_root, nullptr, nullptr) && countNodes(swarm.m_root) == 100;
+
+        swarm.clear();
+        return result;
+    }
+
+    // Test insert, remove and copy on a chain far deeper than a recursive walk could handle
+    bool testDegenerateDepth(Swarm& swarm) {
+        const int teamSize = 20000;
+        for (int i = 0; i < teamSize; i++) {
+            swarm.insert(Robot(i + MINID, SUB));  // Sequential IDs build a chain
+        }
+        bool result = getHeight(swarm.m_root) == teamSize - 1;
+
+        Swarm copySwarm;
+        copySwarm = swarm;  // Clone the chain
+        result = result && getHeight(copySwarm.m_root) == teamSize - 1;
+
+        // Remove from the bottom of the chain, then a node with two children
+        swarm.remove(teamSize - 1 + MINID);
+        swarm.insert(Robot(MINID - 1, BIRD));
+        swarm.remove(MINID);
+        result = result && swarm.m_root->getID() == MINID + 1
+                 && swarm.m_root->m_left->getID() == MINID - 1
+                 && swarm.m_root->getType() == SUB
+                 && getHeight(swarm.m_root) == teamSize - 3
+                 && !swarm.contains(MINID) && swarm.contains(teamSize - 2 + MINID);
+
+        swarm.clear();
+        copySwarm.clear();
+        return result;
+    }
+
+    // Test single-pass splay insert/remove keep the BST property and splay the path
+    bool testSplayRemove(Swarm& swarm) {
+        swarm.setType(SPLAY);
+        for (int i = 1; i <= 100; i++) {
+            swarm.insert(Robot(i + MINID));
+        }
+
+        // Removing joins the subtrees under the predecessor
+        swarm.remove(50 + MINID);
+        bool result = swarm.m_root->getID() == 49 + MINID && !swarm.contains(50 + MINID)
+                      && countNodes(swarm.m_root) == 99;
+
+        // A missing ID leaves the last node on its search path at the root
+        swarm.remove(50 + MINID);
+        result = result && (swarm.m_root->getID() == 49 + MINID || swarm.m_root->getID() == 51 + MINID);
+
+        // Removing the root of a single node tree empties it
+        for (int i = 1; i <= 100; i++) {
+            swarm.remove(i + MINID);
+        }
+        result = result && swarm.m_root == nullptr;
+
+        swarm.insert(Robot(MINID));
+        swarm.remove(MINID);
+        result = result && swarm.m_root == nullptr && isBST(swarm.m_root, nullptr, nullptr);
+        return result;
+    }
+
+    // Test the dense ID index stays in sync through insert, remove, copy and clear
+    bool testDenseIndex(Swarm& swarm) {
+        for (int i = 1; i <= 100; i++) {
+            swarm.insert(Robot(i * 3 + MINID, DRONE));
+        }
+        swarm.setIndexed(true);  // Built from the existing tree
+        swarm.insert(Robot(MAXID, QUADRUPED));
+        swarm.insert(Robot(MINID - 1, BIRD));  // Outside the indexed range
+        swarm.insert(Robot(3 + MINID, SUB));    // Duplicate, rejected by the index
+        swarm.remove(6 + MINID);
+
+        const Robot* robot = swarm.find(3 + MINID);
+        bool result = swarm.isIndexed() && robot == findNode(swarm.m_root, 3 + MINID)
+                      && robot->getType() == DRONE
+                      && swarm.contains(MAXID) && !swarm.contains(6 + MINID)
+                      && swarm.contains(MINID - 1) && swarm.find(MINID - 1)->getType() == BIRD
+                      && countNodes(swarm.m_root) == 101;
+
+        // The copy gets its own index pointing at its own nodes
+        Swarm copySwarm;
+        copySwarm = swarm;
+        result = result && copySwarm.isIndexed()
+                 && copySwarm.find(300 + MINID) == findNode(copySwarm.m_root, 300 + MINID)
+                 && copySwarm.find(300 + MINID) != swarm.find(300 + MINID);
+
+        swarm.clear();
+        result = result && !swarm.contains(3 + MINID) && swarm.find(MAXID) == nullptr
+                 && copySwarm.contains(3 + MINID);
+
+        swarm.setIndexed(false);
+        copySwarm.clear();
+        return result && !swarm.isIndexed();
+    }
+
+    // Test the compact index-linked layout builds the same trees as Swarm
+    bool testCompactSwarm(TREETYPE type) {
+        Swarm swarm(type);
+        CompactSwarm compact(type);
+        for (int i = 0; i < 500; i++) {
+            Robot robot(MINID + (i * 7919) % 2000, static_cast<ROBOTTYPE>(i % 5), (i % 3) ? ALIVE : DEAD);
+            swarm.insert(robot);
+            compact.insert(robot);
+        }
+        for (int i = 0; i < 200; i++) {
+            swarm.remove(MINID + (i * 104729) % 2000);
+            compact.remove(MINID + (i * 104729) % 2000);
+        }
+
+        // Lookups splay both trees the same way in SPLAY mode
+        Robot robot;
+        const Robot* expected = swarm.find(MINID + 7919 % 2000);
+        bool found = compact.find(MINID + 7919 % 2000, robot);
+        bool result = sizeof(CompactSwarm::Node) <= 16
+                      && captureDump(swarm) == captureDump(compact)
+                      && found == (expected != nullptr)
+                      && (expected == nullptr || (robot.getType() == expected->getType()
+                                                  && robot.getState() == expected->getState()))
+                      && !compact.contains(MAXID);
+
+        // Conversions and copies keep the two layouts in step
+        swarm.setType(AVL);
+        compact.setType(AVL);
+        CompactSwarm copy(compact);
+        result = result && captureDump(swarm) == captureDump(copy);
+
+        compact.clear();
+        result = result && !compact.contains(MINID + 7919 % 2000) && copy.contains(MINID + 7919 % 2000);
+        return result;
+    }
+
+    // Test copies of a compact swarm that never allocated can still grow
+    bool testEmptyCompactCopy() {
+        CompactSwarm empty(AVL);
+        CompactSwarm copy(empty);
+        CompactSwarm assigned(AVL);
+        assigned = empty;
+        CompactSwarm reused(AVL);
+        reused.insert(Robot(MINID, BIRD));
+        reused.clear();
+        reused = empty;  // Keeps its own array
+
+        bool result = true;
+        for (int i = 0; i < 100; i++) {
+            copy.insert(Robot(MINID + i, BIRD));
+            assigned.insert(Robot(MINID + i, DRONE));
+            reused.insert(Robot(MINID + i, REPTILE));
+        }
+        for (int i = 0; i < 100; i++) {
+            result = result && copy.contains(MINID + i) && assigned.contains(MINID + i) && reused.contains(MINID + i);
+        }
+        return result && !empty.contains(MINID);
+    }
+
+    // Test a frozen snapshot answers the same lookups as the tree it came from
+    bool testFrozenSwarm(Swarm& swarm) {
+        for (int i = 1; i <= 1000; i++) {
+            swarm.insert(Robot(i * 2 + MINID, static_cast<ROBOTTYPE>(i % 5), (i % 2) ? ALIVE : DEAD));
+        }
+        FrozenSwarm frozen = swarm.freeze();
+        swarm.clear();  // The snapshot owns its own copy
+
+        Robot robot;
+        bool result = frozen.size() == 1000
+                      && frozen.find(500 + MINID, robot) && robot.getType() == static_cast<ROBOTTYPE>(250 % 5)
+                      && robot.getState() == DEAD
+                      && !frozen.contains(501 + MINID) && !frozen.contains(MINID) && !frozen.contains(MAXID)
+                      && frozen.getID(frozen.lowerBound(501 + MINID)) == 502 + MINID
+                      && frozen.getID(frozen.lowerBound(0)) == 2 + MINID
+                      && frozen.lowerBound(2001 + MINID) == 0;
+
+        // Batched lookups agree with single lookups
+        int ids[20];
+        int slots[20];
+        for (int i = 0; i < 20; i++) {
+            ids[i] = MINID + i * 97;
+        }
+        frozen.findBatch(ids, 20, slots);
+        for (int i = 0; i < 20; i++) {
+            result = result && slots[i] == frozen.findSlot(ids[i]);
+        }
+        return result;
+    }
+
+    // Test rank/select/countInRange and the subtree sizes behind them
+    bool testOrderStatistics(Swarm& swarm) {
+        for (int i = 1; i <= 300; i++) {
+            swarm.insert(Robot(i * 10 + MINID));  // IDs MINID+10 .. MINID+3000
+        }
+        for (int i = 1; i <= 300; i += 3) {
+            swarm.remove(i * 10 + MINID);         // Leaves 200 robots
+        }
+        swarm.contains(1500 + MINID);             // Splays in SPLAY mode
+
+        bool result = isSizeCorrect(swarm.m_root) && swarm.size() == 200
+                      && swarm.rank(MINID) == 0
+                      && swarm.rank(35 + MINID) == 2                    // 20 and 30 are below
+                      && swarm.rank(MAXID) == 200
+                      && swarm.select(0)->getID() == 20 + MINID
+                      && swarm.select(199)->getID() == 3000 + MINID
+                      && swarm.select(200) == nullptr
+                      && swarm.countInRange(20 + MINID, 70 + MINID) == 4  // 20, 30, 50, 60
+                      && swarm.countInRange(MINID, MAXID) == 200
+                      && swarm.countInRange(70 + MINID, 60 + MINID) == 0;
+
+        // select() and rank() are inverses
+        for (int k = 0; k < 200; k += 17) {
+            result = result && swarm.rank(swarm.select(k)->getID()) == k;
+        }
+
+        swarm.clear();
+        return result && swarm.size() == 0;
+    }
+
+    // Test ordered iteration and range visits, including trees deeper than the iterator's inline stack
+    bool testIteration(Swarm& swarm) {
+        for (int i = 500; i >= 1; i--) {
+            swarm.insert(Robot(i * 2 + MINID));  // Descending IDs build a left chain in BST mode
+        }
+
+        // Full scan in ID order
+        int count = 0;
+        int previous = 0;
+        bool ordered = true;
+        for (SwarmIterator it = swarm.begin(); it != swarm.end(); ++it) {
+            if (it->getID() <= previous) ordered = false;
+            previous = it->getID();
+            count++;
+        }
+
+        // A range starting between two IDs
+        int visited = 0;
+        int first = 0;
+        swarm.forEachInRange(101 + MINID, 300 + MINID, [&](const Robot& robot) {
+            if (visited == 0) first = robot.getID();
+            visited++;
+        });
+
+        bool result = ordered && count == 500 && previous == 1000 + MINID
+                      && visited == 100 && first == 102 + MINID
+                      && swarm.lowerBound(1000 + MINID)->getID() == 1000 + MINID
+                      && swarm.lowerBound(1001 + MINID) == swarm.end()
+                      && swarm.begin()->getID() == 2 + MINID;
+
+        Swarm empty;
+        result = result && empty.begin() == empty.end();
+
+        swarm.clear();
+        return result;
+    }
+
+    // Test iterating the left chain that sequential splay inserts leave behind:
+    // every ancestor stays on the iterator's stack, so nothing is searched again
+    bool testDeepIteration() {
+        const int count = 20000;
+        Swarm swarm(SPLAY);
+        for (int i = 0; i < count; i++) {
+            swarm.insert(Robot(MINID + i));  // Each insert splays the new maximum to the root
+        }
+
+        SwarmIterator it = swarm.begin();
+        bool result = it->getID() == MINID && it.m_stack.size() == count - 1;
+        int expected = MINID;
+        SwarmIterator middle;
+        for (; it != swarm.end(); ++it) {
+            result = result && it->getID() == expected;
+            if (expected == MINID + count / 2) {
+                middle = it;  // Copies take their own stack
+            }
+            expected++;
+        }
+        result = result && expected == MINID + count && middle->getID() == MINID + count / 2;
+        for (expected = MINID + count / 2; middle != swarm.end(); ++middle) {
+            result = result && middle->getID() == expected++;
+        }
+
+        // Walks built on the iterator see the whole chain
+        Swarm copy(AVL);
+        const char* path = "swarm_chain.bin";
+        result = result && expected == MINID + count && swarm.count(DEFAULT_TYPE, DEFAULT_STATE) == count
+                 && swarm.countInRange(MINID, MAXID, DEFAULT_TYPE, DEFAULT_STATE) == count
+                 && swarm.save(path) && copy.load(path) && sameRobots(swarm, copy);
+        remove(path);
+        return result;
+    }
+
+    // Test that the type/state tallies follow inserts, removals, splays and conversions
+    bool testTallies(Swarm& swarm) {
+        for (int i = 0; i < 300; i++) {
+            ROBOTTYPE type = static_cast<ROBOTTYPE>(i % 5);
+            STATE state = (i % 3 == 0) ? DEAD : ALIVE;
+            swarm.insert(Robot(MINID + i, type, state));
+        }
+        swarm.insert(Robot(MINID, SUB, ALIVE));  // Duplicate ID, must not be counted
+        for (int i = 0; i < 300; i += 2) {
+            swarm.remove(MINID + i);
+        }
+        TREETYPE original = swarm.getType();
+        swarm.setType(original == AVL ? BST : AVL);  // Relink every node
+
+        // Expected counts from a full walk
+        int expected[TYPECOUNT][STATECOUNT] = {};
+        int expectedRange = 0;
+        for (SwarmIterator it = swarm.begin(); it != swarm.end(); ++it) {
+            expected[it->getType()][it->getState()]++;
+            if (it->getID() >= MINID + 40 && it->getID() <= MINID + 160
+                && it->getType() == DRONE && it->getState() == DEAD) {
+                expectedRange++;
+            }
+        }
+
+        bool result = swarm.countInRange(MINID + 40, MINID + 160, DRONE, DEAD) == expectedRange;
+        for (int type = 0; type < TYPECOUNT; type++) {
+            for (int state = 0; state < STATECOUNT; state++) {
+                result = result && swarm.count(static_cast<ROBOTTYPE>(type), static_cast<STATE>(state))
+                                   == expected[type][state];
+            }
+        }
+
+        swarm.clear();
+        swarm.setType(original);
+        return result && swarm.count(DRONE, DEAD) == 0;
+    }
+
+    // Test in-place updates, tombstoning removals and compaction
+    bool testLazyDelete(Swarm& swarm) {
+        for (int i = 0; i < 200; i++) {
+            swarm.insert(Robot(MINID + i, DRONE, ALIVE));
+        }
+        swarm.setLazyDelete(true);
+
+        // In-place updates move robots between tallies without relinking
+        bool result = swarm.setState(MINID + 1, DEAD) && swarm.setRobotType(MINID + 3, BIRD)
+                      && !swarm.setState(MINID + 500, DEAD)
+                      && swarm.count(DRONE, DEAD) == 1 && swarm.count(BIRD, ALIVE) == 1
+                      && swarm.find(MINID + 1)->getState() == DEAD;
+
+        // Tombstone every even ID, then bring one back
+        for (int i = 0; i < 200; i += 2) {
+            swarm.remove(MINID + i);
+        }
+        swarm.insert(Robot(MINID + 10, SUB, DEAD));
+        result = result && countNodes(swarm.m_root) == 200
+                 && swarm.size() == 101 && isSizeCorrect(swarm.m_root)
+                 && !swarm.contains(MINID + 2) && swarm.find(MINID + 10)->getType() == SUB
+                 && swarm.select(0)->getID() == MINID + 1 && swarm.rank(MINID + 11) == 6
+                 && swarm.begin()->getID() == MINID + 1 && swarm.count(DRONE, ALIVE) == 98;
+
+        // Compaction unlinks the tombstones and leaves a balanced tree
+        swarm.compact();
+        result = result && countNodes(swarm.m_root) == 101 && isSizeCorrect(swarm.m_root)
+                 && isBST(swarm.m_root, nullptr, nullptr) && isBalanced(swarm.m_root)
+                 && swarm.contains(MINID + 199) && !swarm.contains(MINID + 198);
+
+        swarm.setLazyDelete(false);
+        swarm.clear();
+        return result;
+    }
+
+    // Test that readers only ever see whole published versions while a writer keeps publishing
+    bool testConcurrentReads(TREETYPE type) {
+        ConcurrentSwarm swarm(type);
+        atomic<bool> done(false);
+        atomic<bool> consistent(true);
+
+        // Robots are inserted in ID order, so a version of n robots holds exactly MINID..MINID+n-1
+        auto reader = [&]() {
+            int last = 0;
+            while (!done.load()) {
+                ConcurrentSwarm::ReadGuard guard(swarm);
+                int n = guard->size();
+                if (n < last || (n > 0 && !guard->contains(MINID + n - 1)) || guard->contains(MINID + n)) {
+                    consistent.store(false);
+                }
+                last = n;
+            }
+        };
+
+        vector<thread> readers;
+        for (int i = 0; i < 3; i++) {
+            readers.push_back(thread(reader));
+        }
+        for (int round = 0; round < 50; round++) {
+            for (int i = 0; i < 100; i++) {
+                swarm.insert(Robot(MINID + round * 100 + i));
+            }
+            swarm.publish();
+        }
+        done.store(true);
+        for (thread& t : readers) {
+            t.join();
+        }
+
+        // With no reader pinned, the next publish frees every retired version
+        swarm.publish();
+        Robot robot;
+        return consistent.load() && swarm.size() == 5000 && swarm.m_retired == nullptr
+               && swarm.find(MINID + 4999, robot) && robot.getID() == MINID + 4999;
+    }
+
+    // Test that snapshots keep their contents while the swarm changes, sharing unchanged nodes
+    bool testSnapshots(Swarm& swarm) {
+        swarm.clear();
+        vector<int> ids;
+        for (int i = 0; i < 1000; i++) {
+            ids.push_back(MINID + 2 * i);
+        }
+        shuffle(ids.begin(), ids.end(), mt19937(7));
+        for (int id : ids) {
+            swarm.insert(Robot(id));
+        }
+
+        // One snapshot per tick, each followed by an insert and a remove
+        int slabsBefore = countSlabs(*swarm.m_pool);
+        vector<Swarm*> history;
+        for (int t = 0; t < 100; t++) {
+            history.push_back(new Swarm(swarm.snapshot()));
+            swarm.insert(Robot(MINID + 2 * t + 1));
+            swarm.remove(MINID + 2 * (t + 500));
+        }
+
+        bool result = swarm.size() == 1000 && isBST(swarm.m_root, nullptr, nullptr)
+                      && isSizeCorrect(swarm.m_root);
+        for (int t = 0; t < 100; t++) {
+            Swarm& past = *history[t];
+            result = result && past.size() == 1000 && isBST(past.m_root, nullptr, nullptr)
+                     && isSizeCorrect(past.m_root)
+                     && (swarm.getType() != AVL || isBalanced(past.m_root))
+                     && !past.contains(MINID + 2 * t + 1)
+                     && (t == 0 || past.contains(MINID + 2 * t - 1))
+                     && past.contains(MINID + 2 * (t + 500));
+        }
+
+        // A hundred deep copies would need about 200 more slabs
+        int slabs = countSlabs(*swarm.m_pool);
+        result = result && slabs - slabsBefore <= 20;
+
+        // Dropping the snapshots frees the copied paths for reuse
+        for (Swarm* past : history) {
+            delete past;
+        }
+        for (int i = 0; i < 1000; i++) {
+            swarm.insert(Robot(MINID + 5000 + i));
+        }
+        result = result && countSlabs(*swarm.m_pool) == slabs && swarm.size() == 2000;
+
+        swarm.clear();
+        return result;
+    }
+
+    // Test copy, move, swap and emplace
+    bool testValueSemantics() {
+        Swarm original(AVL);
+        for (int i = 0; i < 100; i++) {
+            original.emplace(MINID + i, SUB, DEAD);
+        }
+        original.emplace(MINID, BIRD, ALIVE);           // Duplicate ID, ignored
+        original.insert(Robot(MINID + 100, REPTILE));   // Temporary robot
+
+        // A copy is deep and independent
+        Swarm copy(original);
+        copy.remove(MINID + 5);
+        bool result = original.size() == 101 && copy.size() == 100 && original.contains(MINID + 5)
+                      && copy.m_root != original.m_root && isBalanced(copy.m_root)
+                      && original.find(MINID)->getType() == SUB
+                      && original.find(MINID + 100)->getType() == REPTILE
+                      && original.count(SUB, DEAD) == 100;
+
+        // Moves hand over the same nodes and leave the source empty
+        Robot* root = original.m_root;
+        Swarm moved(move(original));
+        result = result && moved.m_root == root && moved.size() == 101 && moved.getType() == AVL
+                 && original.size() == 0 && original.count(SUB, DEAD) == 0;
+        original.insert(Robot(MINID + 7));  // A moved-from swarm is still usable
+        result = result && original.size() == 1;
+
+        vector<Swarm> pipeline;
+        pipeline.push_back(move(moved));
+        pipeline.push_back(Swarm(BST));
+        pipeline.push_back(move(copy));  // Reallocation moves the earlier stages
+        result = result && pipeline[0].m_root == root && pipeline[2].size() == 100;
+
+        copy = move(pipeline[0]);
+        result = result && copy.m_root == root && pipeline[0].size() == 0;
+
+        pipeline[1].swap(copy);
+        result = result && pipeline[1].m_root == root && pipeline[1].getType() == AVL
+                 && copy.size() == 0 && copy.getType() == BST;
+
+        // A move leaves the source without a pool; whatever needs one creates it
+        Swarm source(BST);
+        source.insert(Robot(MINID + 1));
+        Swarm taker(move(source));
+        result = result && source.m_pool == nullptr;
+        source.join(taker);  // Takes over taker's slabs
+        result = result && source.m_pool != nullptr && source.size() == 1 && taker.size() == 0;
+        Swarm spare(move(taker));
+        Swarm upper = taker.split(MINID);
+        Swarm drained(move(spare));
+        Swarm snapshot = spare.snapshot();
+        result = result && upper.size() == 0 && snapshot.size() == 0 && spare.size() == 0;
+        return result;
+    }
+
+    // Test split at an ID and join back together
+    bool testSplitJoin(TREETYPE type) {
+        Swarm swarm(type);
+        for (int i = 0; i < 1000; i++) {
+            swarm.insert(Robot(MINID + i, static_cast<ROBOTTYPE>(i % 5), (i % 2) ? ALIVE : DEAD));
+        }
+        Swarm upper = swarm.split(MINID + 400);
+        bool result = swarm.size() == 400 && upper.size() == 600
+                      && swarm.contains(MINID + 399) && !swarm.contains(MINID + 400)
+                      && upper.select(0)->getID() == MINID + 400
+                      && swarm.count(BIRD, DEAD) == 40 && upper.count(BIRD, DEAD) == 60
+                      && isBST(swarm.m_root, nullptr, nullptr) && isBST(upper.m_root, nullptr, nullptr)
+                      && isSizeCorrect(swarm.m_root) && isSizeCorrect(upper.m_root);
+        if (type == AVL) {
+            result = result && isBalanced(swarm.m_root) && isBalanced(upper.m_root)
+                     && isHeightCorrect(swarm.m_root) && isHeightCorrect(upper.m_root);
+        }
+
+        swarm.join(upper);
+        result = result && swarm.size() == 1000 && upper.size() == 0
+                 && swarm.count(BIRD, DEAD) == 100 && swarm.rank(MINID + 700) == 700
+                 && isBST(swarm.m_root, nullptr, nullptr) && isSizeCorrect(swarm.m_root);
+        if (type == AVL) {
+            result = result && isBalanced(swarm.m_root) && isHeightCorrect(swarm.m_root);
+        }
+        return result;
+    }
+
+    // Test union, intersection and difference against the expected ID sets
+    bool testSetOperations(TREETYPE type) {
+        Swarm::setThreads(4);
+        Swarm evens(type);
+        Swarm thirds(AVL);
+        for (int i = 0; i < 6000; i += 2) {
+            evens.insert(Robot(MINID + i, SUB));
+        }
+        for (int i = 0; i < 6000; i += 3) {
+            thirds.insert(Robot(MINID + i, REPTILE));
+        }
+
+        Swarm both(evens);
+        both.intersectWith(thirds);      // Multiples of 6
+        Swarm either(evens);
+        either.unionWith(thirds);        // Multiples of 2 or 3
+        Swarm onlyEvens(evens);
+        onlyEvens.difference(thirds);    // Multiples of 2 but not 3
+
+        bool result = both.size() == 1000 && either.size() == 4000 && onlyEvens.size() == 2000
+                      && evens.size() == 3000 && thirds.size() == 2000;
+        for (int i = 0; i < 6000 && result; i++) {
+            bool even = i % 2 == 0;
+            bool third = i % 3 == 0;
+            result = both.contains(MINID + i) == (even && third)
+                     && either.contains(MINID + i) == (even || third)
+                     && onlyEvens.contains(MINID + i) == (even && !third);
+        }
+        // Robots already present keep their type, new ones are copied from other
+        result = result && either.count(SUB, ALIVE) == 3000 && either.count(REPTILE, ALIVE) == 1000
+                 && both.count(SUB, ALIVE) == 1000 && isSizeCorrect(either.m_root)
+                 && isBST(either.m_root, nullptr, nullptr);
+        if (type == AVL) {
+            result = result && isBalanced(both.m_root) && isBalanced(either.m_root)
+                     && isBalanced(onlyEvens.m_root) && isHeightCorrect(either.m_root);
+        }
+        Swarm::setThreads(1);
+        return result;
+    }
+
+    // Test sharded writers on disjoint and overlapping ranges
+    bool testShardedSwarm(TREETYPE type) {
+        Swarm::setThreads(4);
+        ShardedSwarm swarm(type, 8);
+        bool result = swarm.shardCount() == 8 && swarm.shardOf(MINID) == 0
+                      && swarm.shardOf(MAXID) == 7 && swarm.shardOf(MINID + IDCOUNT / 2) == 4;
+
+        // Four writers, each interleaving IDs that land in every shard
+        vector<thread> writers;
+        for (int w = 0; w < 4; w++) {
+            writers.push_back(thread([&swarm, w]() {
+                for (int i = 9 * w; i < IDCOUNT; i += 4 * 9) {
+                    swarm.insert(Robot(MINID + i, SUB));
+                }
+            }));
+        }
+        for (thread& t : writers) {
+            t.join();
+        }
+        int expected = (IDCOUNT + 8) / 9;   // IDs MINID + 9k
+        result = result && swarm.size() == expected;
+
+        // Batched remove of every other robot, plus a batched insert
+        vector<int> ids;
+        for (int i = 0; i < IDCOUNT; i += 18) {
+            ids.push_back(MINID + i);
+        }
+        swarm.removeBatch(ids.data(), static_cast<int>(ids.size()));
+        vector<Robot> robots;
+        for (int i = 1; i < IDCOUNT; i += 18) {
+            robots.push_back(Robot(MINID + i, BIRD, DEAD));
+        }
+        swarm.insertBatch(robots.data(), static_cast<int>(robots.size()));
+        result = result && swarm.size() == expected - static_cast<int>(ids.size()) + static_cast<int>(robots.size());
+
+        // Iteration concatenates the shards in ID order, IDs outside MINID..MAXID included
+        swarm.insert(Robot(5, SUB));
+        swarm.insert(Robot(MAXID + 10, SUB));
+        int first = 0;
+        int last = 0;
+        int visited = 0;
+        bool ordered = true;
+        swarm.forEach([&](const Robot& robot) {
+            first = (visited == 0) ? robot.getID() : first;
+            ordered = ordered && robot.getID() > last;
+            last = robot.getID();
+            visited++;
+        });
+        Robot robot;
+        result = result && ordered && visited == swarm.size() && first == 5 && last == MAXID + 10
+                 && swarm.find(MINID + 1, robot) && robot.getType() == BIRD
+                 && !swarm.contains(MINID) && swarm.contains(MINID + 9)
+                 && swarm.setState(MINID + 9, DEAD) && !swarm.setState(MINID + 2, DEAD);
+
+        int inRange = 0;
+        swarm.forEachInRange(MINID + 40000, MINID + 40017, [&](const Robot&) { inRange++; });
+        Swarm::setThreads(1);
+        return result && inRange == 2;   // MINID + 40005 (9k) and MINID + 40015 (inserted)
+    }
+
+    // Test batched operations on both the per-op and the merge path
+    bool testApplyBatch(Swarm& swarm) {
+        swarm.clear();
+        for (int i = 0; i < 1000; i++) {
+            swarm.insert(Robot(MINID + 2 * i, SUB));
+        }
+
+        // Small batch, out of order, with two ops on one ID
+        SwarmOp small[] = {
+            SwarmOp(OPREMOVE, MINID + 11),              // Odd ID, not found
+            SwarmOp(OPINSERT, MINID + 11, BIRD),
+            SwarmOp(OPINSERT, MINID + 4),               // Already present
+            SwarmOp(OPUPDATE, MINID + 6, DRONE, DEAD),
+            SwarmOp(OPREMOVE, MINID + 8),
+            SwarmOp(OPUPDATE, MINID + 9, DRONE, DEAD),  // Not found
+            SwarmOp(OPREMOVE, MINID + 11)               // Runs after the insert above
+        };
+        swarm.applyBatch(small, 7);
+        bool result = small[0].m_result == NOTFOUND && small[1].m_result == APPLIED
+                      && small[2].m_result == ALREADYPRESENT && small[3].m_result == APPLIED
+                      && small[4].m_result == APPLIED && small[5].m_result == NOTFOUND
+                      && small[6].m_result == APPLIED
+                      && swarm.size() == 999 && !swarm.contains(MINID + 11) && !swarm.contains(MINID + 8)
+                      && swarm.find(MINID + 6)->getType() == DRONE && swarm.count(DRONE, DEAD) == 1;
+
+        // Large batch: insert every odd ID and remove every multiple of 4
+        vector<SwarmOp> large;
+        for (int i = 0; i < 2000; i++) {
+            if (i % 2 == 1) {
+                large.push_back(SwarmOp(OPINSERT, MINID + i, REPTILE));
+            } else if (i % 4 == 0) {
+                large.push_back(SwarmOp(OPREMOVE, MINID + i));
+            }
+        }
+        swarm.applyBatch(large.data(), static_cast<int>(large.size()));
+        int notFound = 0;
+        for (const SwarmOp& op : large) {
+            notFound += (op.m_result == NOTFOUND);
+        }
+        // Removed above: MINID + 8 (a multiple of 4) and MINID + 11 (odd, inserted again)
+        result = result && notFound == 1 && swarm.size() == 999 + 1000 - 499
+                 && swarm.count(REPTILE, ALIVE) == 1000 && swarm.count(SUB, ALIVE) == 499
+                 && isBalanced(swarm.m_root) && isBST(swarm.m_root, nullptr, nullptr)
+                 && isSizeCorrect(swarm.m_root) && swarm.contains(MINID + 6) && !swarm.contains(MINID + 12);
+        return result;
+    }
+
+    // Test a binary save/load round trip and rejection of damaged files
+    bool testSaveLoad() {
+        const char* path = "swarm_checkpoint.bin";
+        Swarm original(AVL);
+        for (int id = MINID; id <= MAXID; id++) {
+            original.insert(Robot(id, static_cast<ROBOTTYPE>(id % 5), (id % 3) ? ALIVE : DEAD));
+        }
+        original.remove(MINID + 7);
+
+        Swarm restored(BST);
+        restored.setIndexed(true);
+        bool result = original.save(path) && restored.load(path)
+                      && restored.getType() == AVL && restored.size() == IDCOUNT - 1
+                      && isBalanced(restored.m_root) && isHeightCorrect(restored.m_root)
+                      && isSizeCorrect(restored.m_root) && !restored.contains(MINID + 7)
+                      && restored.find(MAXID)->getType() == static_cast<ROBOTTYPE>(MAXID % 5)
+                      && restored.count(BIRD, DEAD) == original.count(BIRD, DEAD);
+        SwarmIterator a = original.begin();
+        for (SwarmIterator b = restored.begin(); result && b != restored.end(); ++a, ++b) {
+            result = a->getID() == b->getID() && a->getState() == b->getState();
+        }
+
+        // Flip one byte in the middle of the file, the checksum must catch it
+        FILE* file = fopen(path, "r+b");
+        fseek(file, 1000, SEEK_SET);
+        int byte = fgetc(file);
+        fseek(file, 1000, SEEK_SET);
+        fputc(byte ^ 1, file);
+        fclose(file);
+        Swarm untouched(SPLAY);
+        untouched.insert(Robot(MINID));
+        result = result && !untouched.load(path) && untouched.size() == 1 && untouched.getType() == SPLAY
+                 && !untouched.load("no_such_directory/swarm.bin");
+
+        // IDs outside MINID..MAXID that the swarm accepted round-trip as well
+        Swarm outside(SPLAY);
+        outside.insert(Robot(5, DRONE));
+        outside.insert(Robot(-3, SUB, DEAD));
+        outside.insert(Robot(MAXID + 1, BIRD));
+        outside.insert(Robot(MINID, REPTILE));
+        Swarm reloaded(AVL);
+        result = result && outside.save(path) && reloaded.load(path) && sameRobots(outside, reloaded)
+                 && reloaded.size() == 4 && reloaded.find(-3)->getState() == DEAD;
+        remove(path);
+        return result;
+    }
+
+    // Test journal replay, torn tails and checkpoints
+    bool testJournal() {
+        const char* checkpointPath = "swarm_recover.bin";
+        const char* journalPath = "swarm_recover.log";
+        remove(checkpointPath);
+        remove(journalPath);
+
+        Swarm live(AVL);
+        bool result = live.openJournal(journalPath);
+        for (int i = 0; i < 2000; i++) {
+            live.insert(Robot(MINID + i, SUB));
+        }
+        result = result && live.checkpoint(checkpointPath);
+        for (int i = 0; i < 2000; i += 2) {
+            live.remove(MINID + i);
+        }
+        live.setState(MINID + 1, DEAD);
+        live.setRobotType(MINID + 3, BIRD);
+        SwarmOp ops[] = {SwarmOp(OPINSERT, MINID + 5000, DRONE), SwarmOp(OPUPDATE, MINID + 5, REPTILE, DEAD)};
+        live.applyBatch(ops, 2);
+        result = result && live.syncJournal();
+
+        // Recover into a fresh swarm while the original keeps running, as after a crash
+        Swarm restored(AVL);
+        result = result && restored.recover(checkpointPath, journalPath) && sameRobots(live, restored)
+                 && restored.size() == 1001 && restored.count(REPTILE, DEAD) == 1;
+
+        // A torn block at the end is ignored, and cut off when the journal is reopened
+        FILE* file = fopen(journalPath, "ab");
+        fputs("torn", file);
+        fclose(file);
+        Swarm again(AVL);
+        result = result && again.recover(checkpointPath, journalPath) && sameRobots(live, again)
+                 && again.openJournal(journalPath);
+        again.clear();
+        again.insert(Robot(MINID + 42, QUADRUPED));
+        again.closeJournal();
+        Swarm last(BST);
+        result = result && last.recover(checkpointPath, journalPath) && last.size() == 1
+                 && last.find(MINID + 42)->getType() == QUADRUPED;
+
+        live.closeJournal();
+        remove(checkpointPath);
+        remove(journalPath);
+        return result;
+    }
+
+    // Test whole-swarm operations are recovered from the journal
+    bool testJournalBulkOperations() {
+        const char* savePath = "swarm_bulk.bin";
+        const char* checkpointPath = "swarm_bulk_checkpoint.bin";
+        const char* journalPath = "swarm_bulk.log";
+        remove(checkpointPath);
+        remove(journalPath);
+
+        Swarm saved(AVL);
+        for (int i = 0; i < 100; i++) {
+            saved.insert(Robot(MINID + 10 * i, static_cast<ROBOTTYPE>(i % TYPECOUNT)));
+        }
+        bool result = saved.save(savePath);
+
+        // load, then a single insert
+        Swarm live(AVL);
+        result = result && live.openJournal(journalPath) && live.load(savePath);
+        live.insert(Robot(MINID + 1, BIRD));
+        Swarm restored(AVL);
+        result = result && live.syncJournal() && live.size() == 101
+                 && restored.recover(checkpointPath, journalPath) && sameRobots(live, restored);
+
+        // split and join move robots; assignment and set operations replace everything
+        Swarm upper = live.split(MINID + 500);
+        upper.insert(Robot(MINID + 503, SUB));
+        live.join(upper);
+        Swarm other(AVL);
+        for (int i = 0; i < 50; i++) {
+            other.insert(Robot(MINID + 20 * i, DRONE, DEAD));
+        }
+        live.difference(other);
+        live.unionWith(other);
+        Swarm midway(live);
+        result = result && live.syncJournal() && live.size() == 102
+                 && restored.recover(checkpointPath, journalPath) && sameRobots(live, restored);
+        other.intersectWith(live);
+        live = other;
+        Swarm higher(AVL);
+        higher.insert(Robot(MAXID, QUADRUPED));
+        live.join(higher);
+        result = result && live.syncJournal() && live.size() == 51
+                 && restored.recover(checkpointPath, journalPath) && sameRobots(live, restored)
+                 && !sameRobots(midway, restored);
+
+        // Move assignment keeps live's journal and logs the robots it took over
+        Swarm moved(AVL);
+        moved.insert(Robot(MINID + 2, BIRD));
+        moved.insert(Robot(MINID + 3, SUB, DEAD));
+        live = std::move(moved);
+        result = result && live.syncJournal() && live.size() == 2 && moved.size() == 0
+                 && restored.recover(checkpointPath, journalPath) && sameRobots(live, restored);
+
+        live.closeJournal();
+        remove(savePath);
+        remove(journalPath);
+        return result;
+    }
+
+    // Test a memory mapped frozen swarm against the one it was saved from
+    bool testMappedSwarm() {
+        const char* path = "swarm_mapped.bin";
+        Swarm swarm(AVL);
+        for (int i = 0; i < 30000; i++) {
+            swarm.insert(Robot(MINID + 3 * i, static_cast<ROBOTTYPE>(i % 5), (i % 4) ? ALIVE : DEAD));
+        }
+        FrozenSwarm frozen = swarm.freeze();
+        FrozenSwarm mapped;
+        bool result = frozen.save(path) && mapped.map(path) && mapped.isMapped() && !frozen.isMapped()
+                      && mapped.size() == 30000 && mapped.count(BIRD, DEAD) == swarm.count(BIRD, DEAD)
+                      && mapped.count(SUB, ALIVE) == frozen.count(SUB, ALIVE);
+
+        Robot robot;
+        for (int id = MINID; id < MINID + 90000 && result; id += 7) {
+            result = mapped.contains(id) == frozen.contains(id)
+                     && mapped.lowerBound(id) == frozen.lowerBound(id);
+        }
+        result = result && mapped.find(MINID + 3 * 8, robot) && robot.getType() == SUB && robot.getState() == DEAD;
+
+        // Range scan straight out of the mapping
+        vector<int> seen;
+        mapped.forEachInRange(MINID + 100, MINID + 130, [&](int id, ROBOTTYPE, STATE) { seen.push_back(id); });
+        result = result && seen.size() == 10 && seen.front() == MINID + 102 && seen.back() == MINID + 129;
+
+        // A copy owns its arrays, and a short file is rejected without touching the view
+        const char* shortPath = "swarm_mapped_short.bin";
+        FrozenSwarm copy(mapped);
+        FILE* file = fopen(path, "r+b");
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        fclose(file);
+        result = result && !copy.isMapped() && copy.contains(MINID + 3) && copy.count(BIRD, DEAD) == mapped.count(BIRD, DEAD)
+                 && copyPrefix(path, shortPath, length - 1) && !mapped.map(shortPath) && mapped.size() == 30000
+                 && !mapped.map("no_such_directory/mapped.bin");
+
+        // More robots than IDCOUNT, with IDs outside MINID..MAXID, map back in
+        // full; a header claiming far more robots than the file holds does not
+        const char* largePath = "swarm_mapped_large.bin";
+        vector<Robot> robots;
+        for (int i = 0; i < IDCOUNT + 10000; i++) {
+            robots.push_back(Robot(2 * i - 50000, static_cast<ROBOTTYPE>(i % 5)));
+        }
+        Swarm large(AVL);
+        large.bulkLoad(robots.data(), static_cast<int>(robots.size()));
+        FrozenSwarm largeMapped;
+        result = result && large.freeze().save(largePath) && largeMapped.map(largePath)
+                 && largeMapped.size() == IDCOUNT + 10000 && largeMapped.contains(-50000)
+                 && largeMapped.contains(2 * (IDCOUNT + 9999) - 50000) && !largeMapped.contains(-49999)
+                 && largeMapped.count(DRONE, ALIVE) == large.count(DRONE, ALIVE);
+        unsigned int hugeCount = 0xFFFFFFFFu;
+        file = fopen(largePath, "r+b");
+        fseek(file, 12, SEEK_SET);
+        fwrite(&hugeCount, sizeof(hugeCount), 1, file);
+        fclose(file);
+        result = result && !largeMapped.map(largePath) && largeMapped.size() == IDCOUNT + 10000;
+        remove(largePath);
+        remove(shortPath);
+        remove(path);
+        return result && mapped.contains(MINID + 3);   // Still valid after the file is gone
+    }
+
+    // Test every export format against the expected text
+    bool testExport() {
+        Swarm swarm(AVL);
+        swarm.insert(Robot(MINID + 2, SUB, DEAD));
+        swarm.insert(Robot(MINID + 1, BIRD));
+        swarm.insert(Robot(MINID + 3, QUADRUPED));
+        string tree = exportString(swarm, EXPORTTREE);
+        bool result = tree == captureDump(swarm)
+                      && tree == "((10001:0)10002:1(10003:0))\n"
+                      && exportString(swarm, EXPORTIDS) == "10001\n10002\n10003\n"
+                      && exportString(swarm, EXPORTCSV)
+                         == "id,type,state\n10001,BIRD,ALIVE\n10002,SUB,DEAD\n10003,QUADRUPED,ALIVE\n"
+                      && exportString(swarm, EXPORTJSON)
+                         == "{\"type\":\"AVL\",\"size\":3,\"robots\":[\n"
+                            "{\"id\":10001,\"type\":\"BIRD\",\"state\":\"ALIVE\"},\n"
+                            "{\"id\":10002,\"type\":\"SUB\",\"state\":\"DEAD\"},\n"
+                            "{\"id\":10003,\"type\":\"QUADRUPED\",\"state\":\"ALIVE\"}\n]}\n";
+        Swarm empty(BST);
+        result = result && exportString(empty, EXPORTJSON) == "{\"type\":\"BST\",\"size\":0,\"robots\":[]}\n"
+                 && exportString(empty, EXPORTTREE) == "\n";
+
+        // A large swarm spans several buffer flushes; a descriptor gets the same bytes
+        for (int id = MINID; id <= MAXID; id++) {
+            swarm.insert(Robot(id, static_cast<ROBOTTYPE>(id % 5)));
+        }
+        const char* path = "swarm_export.csv";
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        result = result && fd >= 0 && swarm.exportTo(fd, EXPORTCSV);
+        close(fd);
+        FILE* file = fopen(path, "rb");
+        string written;
+        char chunk[4096];
+        size_t length;
+        while (file != nullptr && (length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            written.append(chunk, length);
+        }
+        if (file != nullptr) {
+            fclose(file);
+        }
+        remove(path);
+        string ids = exportString(swarm, EXPORTIDS);
+        return result && written == exportString(swarm, EXPORTCSV)
+               && count(ids.begin(), ids.end(), '\n') == IDCOUNT
+               && ids.compare(0, 12, "10000\n10001\n") == 0 && !swarm.exportTo(-1, EXPORTIDS);
+    }
+
 private:
+    // Capture an export as a string
+    string exportString(const Swarm& swarm, EXPORTFORMAT format) {
+        ostringstream out;
+        swarm.exportTo(out, format);
+        return out.str();
+    }
+
+    // Capture the output of dumpTree() as a string
+    template <class T>
+    string captureDump(const T& swarm) {
+        ostringstream out;
+        streambuf* old = cout.rdbuf(out.rdbuf());
+        swarm.dumpTree();
+        cout.rdbuf(old);
+        return out.str();
+    }
+
+    // Copy the first length bytes of a file into another file
+    bool copyPrefix(const char* path, const char* target, long length) {
+        FILE* file = fopen(path, "rb");
+        vector<char> bytes(length);
+        bool read = file != nullptr && fread(bytes.data(), 1, length, file) == static_cast<size_t>(length);
+        if (file != nullptr) {
+            fclose(file);
+        }
+        file = fopen(target, "wb");
+        bool written = file != nullptr && fwrite(bytes.data(), 1, length, file) == static_cast<size_t>(length);
+        if (file != nullptr) {
+            fclose(file);
+        }
+        return read && written;
+    }
+
+    // Check that two swarms hold the same robots in the same order
+    bool sameRobots(const Swarm& first, const Swarm& second) {
+        SwarmIterator a = first.begin();
+        SwarmIterator b = second.begin();
+        for (; a != first.end() && b != second.end(); ++a, ++b) {
+            if (a->getID() != b->getID() || a->getType() != b->getType() || a->getState() != b->getState()) {
+                return false;
+            }
+        }
+        return a == first.end() && b == second.end();
+    }
+
     // Check if the tree is balanced (used for AVL tests)
     bool isBalanced(Robot* node) {
         if (node == nullptr) return true;
@@ -182,6 +1303,13 @@ private:
         return isBST(node->m_left, min, node) && isBST(node->m_right, node, max);
     }
 
+    // Check that every subtree size matches the number of live nodes below it
+    bool isSizeCorrect(Robot* node) {
+        if (node == nullptr) return true;
+        if (node->m_size != countLive(node)) return false;
+        return isSizeCorrect(node->m_left) && isSizeCorrect(node->m_right);
+    }
+
     // Check if the height is correct (for Splay trees)
     bool isHeightCorrect(Robot* node) {
         if (node == nullptr) return true;
@@ -204,6 +1332,35 @@ private:
         return contains(node->m_right, id);
     }
 
+    // Count the nodes in a tree
+    int countNodes(Robot* node) {
+        if (node == nullptr) return 0;
+        return 1 + countNodes(node->m_left) + countNodes(node->m_right);
+    }
+
+    // Count the nodes in a tree that are not tombstoned
+    int countLive(Robot* node) {
+        if (node == nullptr) return 0;
+        return (node->m_deleted ? 0 : 1) + countLive(node->m_left) + countLive(node->m_right);
+    }
+
+    // Count the slabs a pool has allocated
+    int countSlabs(const RobotPool& pool) {
+        int count = 0;
+        for (RobotPool::Slab* slab = pool.m_slabs; slab != nullptr; slab = slab->m_next) {
+            count++;
+        }
+        return count;
+    }
+
+    // Find the node with a specific ID
+    Robot* findNode(Robot* node, int id) {
+        while (node != nullptr && node->getID() != id) {
+            node = (id < node->getID()) ? node->m_left : node->m_right;
+        }
+        return node;
+    }
+
     // Get height of a node
     int getHeight(Robot* node) {
         return (node == nullptr) ? -1 : node->getHeight();
@@ -277,5 +1434,175 @@ int main() {
          << (tester.testAVLTreeHeight(avlSwarm) ? "Passed" : "Failed") 
          << endl;
 
+    // Test node pool allocation and reuse on a swarm with an untouched pool
+    Swarm poolSwarm(BST);
+    cout << "Node Pool Reuse: " 
+         << (tester.testNodePoolReuse(poolSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test linear clear() on a degenerate BST
+    cout << "Clear Degenerate BST: " 
+         << (tester.testClearDegenerate(bstSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test in-place tree type conversions
+    Swarm convertSwarm(BST);
+    cout << "Tree Type Conversion: " 
+         << (tester.testTypeConversion(convertSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test bulk loading in BST mode
+    cout << "Bulk Load: " 
+         << (tester.testBulkLoad(bstSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test point lookups
+    cout << "Find and Contains (AVL): " 
+         << (tester.testFindContains(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Find and Contains (Splay): " 
+         << (tester.testFindContains(splaySwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test iterative operations on a degenerate BST
+    cout << "Degenerate BST Depth: " 
+         << (tester.testDegenerateDepth(bstSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test top-down splay removal
+    cout << "Splay Removal: " 
+         << (tester.testSplayRemove(splaySwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test the dense ID index
+    cout << "Dense ID Index: " 
+         << (tester.testDenseIndex(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test the compact node layout against Swarm
+    cout << "Compact Layout (AVL): " 
+         << (tester.testCompactSwarm(AVL) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Compact Layout (Splay): " 
+         << (tester.testCompactSwarm(SPLAY) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Compact Copy of Empty Swarm: " 
+         << (tester.testEmptyCompactCopy() ? "Passed" : "Failed") 
+         << endl;
+
+    // Test the frozen Eytzinger snapshot
+    cout << "Frozen Snapshot: " 
+         << (tester.testFrozenSwarm(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test order statistics
+    cout << "Order Statistics (AVL): " 
+         << (tester.testOrderStatistics(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Order Statistics (Splay): " 
+         << (tester.testOrderStatistics(splaySwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test iterators and range scans
+    cout << "Ordered Iteration (BST): " 
+         << (tester.testIteration(bstSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Ordered Iteration (AVL): " 
+         << (tester.testIteration(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Ordered Iteration (Deep Splay Chain): " 
+         << (tester.testDeepIteration() ? "Passed" : "Failed") 
+         << endl;
+
+    // Test type/state tallies
+    cout << "Type/State Tallies (BST): " 
+         << (tester.testTallies(bstSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Type/State Tallies (Splay): " 
+         << (tester.testTallies(splaySwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test lazy deletion and in-place updates
+    cout << "Lazy Delete and Compaction (AVL): " 
+         << (tester.testLazyDelete(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Lazy Delete and Compaction (Splay): " 
+         << (tester.testLazyDelete(splaySwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test concurrent readers against a publishing writer
+    cout << "Concurrent Reads (AVL): " 
+         << (tester.testConcurrentReads(AVL) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Concurrent Reads (Splay): " 
+         << (tester.testConcurrentReads(SPLAY) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test persistent snapshots
+    cout << "Persistent Snapshots (BST): " 
+         << (tester.testSnapshots(bstSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Persistent Snapshots (AVL): " 
+         << (tester.testSnapshots(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test value semantics
+    cout << "Copy, Move and Emplace: " 
+         << (tester.testValueSemantics() ? "Passed" : "Failed") 
+         << endl;
+
+    // Test split/join and set operations
+    cout << "Split and Join (AVL): " 
+         << (tester.testSplitJoin(AVL) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Split and Join (Splay): " 
+         << (tester.testSplitJoin(SPLAY) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Set Operations (AVL): " 
+         << (tester.testSetOperations(AVL) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Set Operations (BST): " 
+         << (tester.testSetOperations(BST) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test the sharded swarm
+    cout << "Sharded Writers (AVL): " 
+         << (tester.testShardedSwarm(AVL) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Sharded Writers (Splay): " 
+         << (tester.testShardedSwarm(SPLAY) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test batched operations
+    cout << "Batched Operations (AVL): " 
+         << (tester.testApplyBatch(avlSwarm) ? "Passed" : "Failed") 
+         << endl;
+    cout << "Batched Operations (Splay): " 
+         << (tester.testApplyBatch(splaySwarm) ? "Passed" : "Failed") 
+         << endl;
+
+    // Test binary checkpoints
+    cout << "Binary Save/Load: " 
+         << (tester.testSaveLoad() ? "Passed" : "Failed") 
+         << endl;
+
+    // Test the write-ahead journal
+    cout << "Journal Recovery: " 
+         << (tester.testJournal() ? "Passed" : "Failed") 
+         << endl;
+    cout << "Journal Recovery of Whole-Swarm Operations: " 
+         << (tester.testJournalBulkOperations() ? "Passed" : "Failed") 
+         << endl;
+
+    // Test memory mapped frozen swarms
+    cout << "Memory Mapped Frozen Swarm: " 
+         << (tester.testMappedSwarm() ? "Passed" : "Failed") 
+         << endl;
+
+    // Test the buffered exports
+    cout << "Buffered Export Formats: " 
+         << (tester.testExport() ? "Passed" : "Failed") 
+         << endl;
+
     return 0;
 }
\ No newline at end of file
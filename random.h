@@ -0,0 +1,189 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Random number generator shared by driver.cpp and bench.cpp
+enum RANDOM {UNIFORMINT, UNIFORMREAL, NORMAL, SHUFFLE, ZIPF, SEQUENTIAL};
+class Random {
+public:
+    Random(){}
+    Random(int min, int max, RANDOM type=UNIFORMINT, int mean=50, int stdev=20) : m_min(min), m_max(max), m_type(type)
+    {
+        if (type == NORMAL){
+            //the case of NORMAL to generate integer numbers with normal distribution
+            m_generator = std::mt19937(m_device());
+            //the data set will have the mean of 50 (default) and standard deviation of 20 (default)
+            //the mean and standard deviation can change by passing new values to constructor 
+            m_normdist = std::normal_distribution<>(mean,stdev);
+        }
+        else if (type == UNIFORMINT) {
+            //the case of UNIFORMINT to generate integer numbers
+            // Using a fixed seed value generates always the same sequence
+            // of pseudorandom numbers, e.g. reproducing scientific experiments
+            // here it helps us with testing since the same sequence repeats
+            m_generator = std::mt19937(10);// 10 is the fixed seed value
+            m_unidist = std::uniform_int_distribution<>(min,max);
+        }
+        else if (type == UNIFORMREAL) { //the case of UNIFORMREAL to generate real numbers
+            m_generator = std::mt19937(10);// 10 is the fixed seed value
+            m_uniReal = std::uniform_real_distribution<double>((double)min,(double)max);
+        }
+        else if (type == ZIPF) {
+            //the case of ZIPF to generate integer numbers where the value
+            //min + k - 1 has a probability proportional to 1 / k^exponent,
+            //so a few low values are drawn far more often than the rest
+            m_generator = std::mt19937(10);// 10 is the fixed seed value
+            m_uniReal = std::uniform_real_distribution<double>(0.0,1.0);
+            setExponent(0.99);
+        }
+        else if (type == SEQUENTIAL) {
+            //the case of SEQUENTIAL to generate min, min+1, ..., max, min, ...
+            m_next = min;
+        }
+        else { //the case of SHUFFLE to generate every number only once
+            m_generator = std::mt19937(m_device());
+        }
+    }
+    void setSeed(int seedNum){
+        // we have set a default value for seed in constructor
+        // we can change the seed by calling this function after constructor call
+        // this gives us more randomness
+        m_generator = std::mt19937(seedNum);
+    }
+    void init(int min, int max){
+        m_min = min;
+        m_max = max;
+        m_type = UNIFORMINT;
+        m_generator = std::mt19937(10);// 10 is the fixed seed value
+        m_unidist = std::uniform_int_distribution<>(min,max);
+    }
+    void setExponent(double exponent){
+        // this function sets the skew of a ZIPF generator, 0 is uniform
+        // and larger values concentrate the draws on fewer values
+        // the cumulative weights are tabulated once, getRandNum() then
+        // does a binary search in the table
+        m_cdf.assign(m_max - m_min + 1, 0.0);
+        double total = 0.0;
+        for (int k = 1; k <= m_max - m_min + 1; k++){
+            total += 1.0 / std::pow((double)k, exponent);
+            m_cdf[k - 1] = total;
+        }
+        for (double & weight : m_cdf){
+            weight /= total;
+        }
+    }
+    void getShuffle(vector<int> & array){
+        // this function provides a list of all values between min and max
+        // in a random order, this function guarantees the uniqueness
+        // of every value in the list
+        // the user program creates the vector param and passes here
+        // here we populate the vector using m_min and m_max
+        for (int i = m_min; i<=m_max; i++){
+            array.push_back(i);
+        }
+        shuffle(array.begin(),array.end(),m_generator);
+    }
+
+    void getShuffle(int array[]){
+        // this function provides a list of all values between min and max
+        // in a random order, this function guarantees the uniqueness
+        // of every value in the list
+        // the param array must be of the size (m_max-m_min+1)
+        // the user program creates the array and pass it here
+        vector<int> temp;
+        for (int i = m_min; i<=m_max; i++){
+            temp.push_back(i);
+        }
+        std::shuffle(temp.begin(), temp.end(), m_generator);
+        vector<int>::iterator it;
+        int i = 0;
+        for (it=temp.begin(); it != temp.end(); it++){
+            array[i] = *it;
+            i++;
+        }
+    }
+
+    int getRandNum(){
+        // this function returns integer numbers
+        // the object must have been initialized to generate integers
+        int result = 0;
+        if(m_type == NORMAL){
+            //returns a random number in a set with normal distribution
+            //we limit random numbers by the min and max values
+            result = m_min - 1;
+            while(result < m_min || result > m_max)
+                result = m_normdist(m_generator);
+        }
+        else if (m_type == UNIFORMINT){
+            //this will generate a random number between min and max values
+            result = m_unidist(m_generator);
+        }
+        else if (m_type == ZIPF){
+            //find the first value whose cumulative weight reaches a uniform draw
+            double draw = m_uniReal(m_generator);
+            result = m_min + (int)(std::lower_bound(m_cdf.begin(), m_cdf.end(), draw) - m_cdf.begin());
+            if (result > m_max) result = m_max;
+        }
+        else if (m_type == SEQUENTIAL){
+            //returns the next value in order and wraps around after max
+            result = m_next;
+            m_next = (m_next == m_max) ? m_min : m_next + 1;
+        }
+        else if (m_type == SHUFFLE){
+            //walks a shuffled list of every value, reshuffling after each pass
+            if (m_order.empty() || m_next >= (int)m_order.size()){
+                if (m_order.empty()) getShuffle(m_order);
+                else std::shuffle(m_order.begin(), m_order.end(), m_generator);
+                m_next = 0;
+            }
+            result = m_order[m_next++];
+        }
+        return result;
+    }
+
+    double getRealRandNum(){
+        // this function returns real numbers
+        // the object must have been initialized to generate real numbers
+        double result = m_uniReal(m_generator);
+        // a trick to return numbers only with two deciaml points
+        // for example if result is 15.0378, function returns 15.03
+        // to round up we can use ceil function instead of floor
+        result = std::floor(result*100.0)/100.0;
+        return result;
+    }
+
+    string getRandString(int size){
+        // the parameter size specifies the length of string we ask for
+        // to use ASCII char the number range in constructor must be set to 97 - 122
+        // and the Random type must be UNIFORMINT (it is default in constructor)
+        string output = "";
+        for (int i=0;i<size;i++){
+            output = output + (char)getRandNum();
+        }
+        return output;
+    }
+    
+    int getMin(){return m_min;}
+    int getMax(){return m_max;}
+    private:
+    int m_min;
+    int m_max;
+    RANDOM m_type;
+    std::random_device m_device;
+    std::mt19937 m_generator;
+    std::normal_distribution<> m_normdist;//normal distribution
+    std::uniform_int_distribution<> m_unidist;//integer uniform distribution
+    std::uniform_real_distribution<double> m_uniReal;//real uniform distribution
+    vector<double> m_cdf;//cumulative weights for ZIPF
+    vector<int> m_order;//shuffled values walked by SHUFFLE
+    int m_next = 0;//next value for SEQUENTIAL, next position for SHUFFLE
+
+};
+
+#endif
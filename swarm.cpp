@@ -1,331 +1,3743 @@
 #include "swarm.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 using namespace std;
 
+// Journal record kind for clear(), after the OPKIND values
+static const int JOURNALCLEAR = OPUPDATE + 1;
+
+// Pool constructor - Slabs are allocated on first use
+RobotPool::RobotPool() : m_slabs(nullptr), m_freeList(nullptr), m_users(1) {}
+
+// Pool destructor - Free every slab
+RobotPool::~RobotPool() {
+    releaseAll();
+}
+
+// Allocate a node for robot, growing the pool by one slab if the free list is empty
+Robot* RobotPool::allocate(const Robot& robot) {
+    if (m_freeList == nullptr) {
+        grow();
+    }
+
+    Robot* node = m_freeList;
+    m_freeList = node->m_right;
+
+    *node = robot;
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+    node->m_height = DEFAULT_HEIGHT;
+    node->m_size = DEFAULT_SIZE;
+    node->m_refs = DEFAULT_REFS;
+    return node;
+}
+
+// Allocate a node and construct the robot in it directly
+Robot* RobotPool::allocate(int id, ROBOTTYPE type, STATE state) {
+    if (m_freeList == nullptr) {
+        grow();
+    }
+
+    Robot* node = m_freeList;
+    m_freeList = node->m_right;
+
+    node->m_id = id;
+    node->m_type = type;
+    node->m_state = state;
+    node->m_deleted = false;
+    node->m_refs = DEFAULT_REFS;
+    node->m_left = nullptr;
+    node->m_right = nullptr;
+    node->m_height = DEFAULT_HEIGHT;
+    node->m_size = DEFAULT_SIZE;
+    return node;
+}
+
+// Push a node back onto the free list for reuse
+void RobotPool::release(Robot* node) {
+    node->m_left = nullptr;
+    node->m_right = m_freeList;
+    m_freeList = node;
+}
+
+// Free all slabs at once, every node handed out by the pool becomes invalid
+void RobotPool::releaseAll() {
+    while (m_slabs != nullptr) {
+        Slab* next = m_slabs->m_next;
+        delete m_slabs;
+        m_slabs = next;
+    }
+    m_freeList = nullptr;
+}
+
+// Adopt function - Take over other's slabs so the nodes carved from them can
+// join this pool's trees. Other's free nodes are not recycled; they are freed
+// with the slabs.
+void RobotPool::adopt(RobotPool& other) {
+    if (other.m_slabs == nullptr) {
+        return;
+    }
+    Slab* last = other.m_slabs;
+    while (last->m_next != nullptr) {
+        last = last->m_next;
+    }
+    last->m_next = m_slabs;
+    m_slabs = other.m_slabs;
+    other.m_slabs = nullptr;
+    other.m_freeList = nullptr;
+}
+
+// Register one more swarm sharing the pool
+void RobotPool::addUser() {
+    m_users++;
+}
+
+// Unregister a swarm, returning how many still share the pool
+int RobotPool::dropUser() {
+    return --m_users;
+}
+
+// Allocate a new slab and push its nodes so they are handed out in address order
+void RobotPool::grow() {
+    Slab* slab = new Slab;
+    slab->m_next = m_slabs;
+    m_slabs = slab;
+
+    for (int i = SLABSIZE - 1; i >= 0; i--) {
+        slab->m_nodes[i].m_right = m_freeList;
+        m_freeList = &slab->m_nodes[i];
+    }
+}
+
+// Index constructor - Start with no IDs present
+RobotIndex::RobotIndex() {
+    clear();
+}
+
+// Record a node under its ID
+void RobotIndex::set(Robot* node) {
+    if (covers(node->m_id)) {
+        int slot = node->m_id - MINID;
+        m_present[slot >> 5] |= 1u << (slot & 31);
+        m_nodes[slot] = node;
+    }
+}
+
+// Forget an ID
+void RobotIndex::erase(int id) {
+    if (covers(id)) {
+        int slot = id - MINID;
+        m_present[slot >> 5] &= ~(1u << (slot & 31));
+        m_nodes[slot] = nullptr;
+    }
+}
+
+// Forget every ID
+void RobotIndex::clear() {
+    memset(m_present, 0, sizeof(m_present));
+    memset(m_nodes, 0, sizeof(m_nodes));
+}
+
+// Iterator constructor - End iterator
+SwarmIterator::SwarmIterator()
+    : m_root(nullptr), m_node(nullptr) {}
+
+// Iterator constructor - Position at the first robot with ID >= id
+SwarmIterator::SwarmIterator(Robot* root, int id)
+    : m_root(root), m_node(nullptr) {
+    seek(id);
+    while (m_node != nullptr && m_node->m_deleted) {
+        step();
+    }
+}
+
+// Advance to the next live robot in ID order, skipping tombstones
+SwarmIterator& SwarmIterator::operator++() {
+    do {
+        step();
+    } while (m_node != nullptr && m_node->m_deleted);
+    return *this;
+}
+
+// Move to the in-order successor node
+void SwarmIterator::step() {
+    if (m_node->m_right != nullptr) {
+        // Leftmost robot of the right subtree
+        Robot* node = m_node->m_right;
+        while (node->m_left != nullptr) {
+            m_stack.push(node);
+            node = node->m_left;
+        }
+        m_node = node;
+    } else if (!m_stack.empty()) {
+        m_node = m_stack.pop();  // Nearest ancestor whose left subtree we just finished
+    } else {
+        m_node = nullptr;  // End of the swarm
+    }
+}
+
+// Descend from the root to the first robot with ID >= id, keeping the
+// nodes where the descent turned left as the pending ancestors
+void SwarmIterator::seek(int id) {
+    m_stack.clear();
+    Robot* node = m_root;
+    while (node != nullptr) {
+        if (node->getID() >= id) {
+            m_stack.push(node);
+            node = node->m_left;
+        } else {
+            node = node->m_right;
+        }
+    }
+    m_node = m_stack.empty() ? nullptr : m_stack.pop();
+}
+
+// Constructor - Default tree type is NONE
+Swarm::Swarm()
+    : m_root(nullptr), m_type(NONE), m_pool(new RobotPool), m_index(nullptr),
+      m_lazyDelete(false), m_shared(false), m_journal(nullptr) {
+    clearTally();
+}
+
+// Constructor - Initialize with specific tree type
+Swarm::Swarm(TREETYPE type)
+    : m_root(nullptr), m_type(type), m_pool(new RobotPool), m_index(nullptr),
+      m_lazyDelete(false), m_shared(false), m_journal(nullptr) {
+    clearTally();
+}
+
+// Copy constructor - Deep copy of rhs into a pool of its own
+Swarm::Swarm(const Swarm& rhs)
+    : m_root(nullptr), m_type(NONE), m_pool(new RobotPool), m_index(nullptr),
+      m_lazyDelete(false), m_shared(false), m_journal(nullptr) {
+    clearTally();
+    *this = rhs;
+}
+
+// Move constructor - Take over rhs's nodes, pool and index in O(1). rhs is
+// left empty without a pool, which it creates on its next insert.
+Swarm::Swarm(Swarm&& rhs) noexcept
+    : m_root(nullptr), m_type(rhs.m_type), m_pool(nullptr), m_index(nullptr),
+      m_lazyDelete(false), m_shared(false), m_journal(nullptr) {
+    clearTally();
+    swap(rhs);
+}
+
+// Snapshot constructor - Share source's nodes and pool. Both swarms now have
+// to copy a node before writing to it.
+Swarm::Swarm(Swarm* source)
+    : m_root(source->m_root), m_type(source->m_type), m_pool(source->pool()), m_index(nullptr),
+      m_lazyDelete(source->m_lazyDelete), m_shared(true), m_journal(nullptr) {
+    memcpy(m_tally, source->m_tally, sizeof(m_tally));
+    m_tallyStale = source->m_tallyStale;
+    m_pool->addUser();
+    addRef(m_root);
+    source->m_shared = true;
+}
+
+// Destructor - Every node lives in m_pool, which frees its slabs in one sweep
+// once no snapshot shares it
+Swarm::~Swarm() {
+    if (m_pool == nullptr) {
+        // Moved from before it allocated again, nothing to free
+    } else if (m_pool->dropUser() == 0) {
+        delete m_pool;
+    } else {
+        dropTree(m_root);  // Other swarms may still link to these nodes
+    }
+    m_root = nullptr;
+    delete m_index;
+    closeJournal();  // Commits the last group
+}
+
+// Clear function - Deallocates all memory in the tree
+void Swarm::clear() {
+    journal(JOURNALCLEAR, DEFAULT_ID, DEFAULT_TYPE, DEFAULT_STATE);
+    if (m_shared) {
+        dropTree(m_root);
+        if (m_index != nullptr) {
+            m_index->clear();
+        }
+        m_shared = false;
+    } else {
+        clearHelper(m_root);
+    }
+    m_root = nullptr;
+    clearTally();
+}
+
+// Return every node of a subtree to the pool in one O(n) pass. Left children
+// are rotated up onto the right spine as they are met, so the walk needs no
+// stack or recursion and never rebalances.
+void Swarm::clearHelper(Robot* node) {
+    while (node != nullptr) {
+        if (node->m_left != nullptr) {
+            // Right rotation: the left child becomes the new top of the spine
+            Robot* left = node->m_left;
+            node->m_left = left->m_right;
+            left->m_right = node;
+            node = left;
+        } else {
+            // No left subtree, free the node and continue down the spine
+            Robot* right = node->m_right;
+            if (m_index != nullptr) {
+                m_index->erase(node->m_id);
+            }
+            m_pool->release(node);
+            node = right;
+        }
+    }
+}
+
+// Enable or disable the dense ID index, building it from the current tree
+void Swarm::setIndexed(bool indexed) {
+    if (indexed && m_index == nullptr) {
+        m_index = new RobotIndex;
+        indexTree();
+    } else if (!indexed && m_index != nullptr) {
+        delete m_index;
+        m_index = nullptr;
+    }
+}
+
+// Check whether the dense ID index is enabled
+bool Swarm::isIndexed() const {
+    return m_index != nullptr;
+}
+
+// Record every node of the tree in the index with an iterative pre-order walk
+void Swarm::indexTree() {
+    RobotStack stack;
+    if (m_root != nullptr) {
+        stack.push(m_root);
+    }
+    while (!stack.empty()) {
+        Robot* node = stack.pop();
+        if (!node->m_deleted) {
+            m_index->set(node);
+        }
+        if (node->m_left != nullptr) stack.push(node->m_left);
+        if (node->m_right != nullptr) stack.push(node->m_right);
+    }
+}
+
+// Insert function - Insert a robot into the tree
+void Swarm::insert(const Robot& robot) {
+    emplace(robot.getID(), robot.getType(), robot.getState());
+}
+
+// Insert function - Robots own no resources, so this is the same as a copy
+void Swarm::insert(Robot&& robot) {
+    emplace(robot.getID(), robot.getType(), robot.getState());
+}
+
+// Emplace function - Insert a robot built directly in its tree node
+void Swarm::emplace(int id, ROBOTTYPE type, STATE state) {
+    journal(OPINSERT, id, type, state);
+    if (m_index != nullptr && RobotIndex::covers(id) && m_index->test(id)) {
+        return;  // Duplicate ID, answered by the index without touching the tree
+    }
+
+    if (m_type == SPLAY) {
+        detach();  // Splaying rewrites the whole access path
+        splayInsert(id, type, state);
+        return;
+    }
+
+    Robot* newRobot = pool()->allocate(id, type, state);  // Allocate new robot node from the pool
+
+    if (!insertHelper(newRobot)) {
+        m_pool->release(newRobot);  // Duplicate ID, the robot already in the tree stays
+    }
+}
+
+// Splay insertion - Splay the ID to the root, then split the tree around a
+// new root node. One top-down pass, and no allocation for a duplicate ID.
+void Swarm::splayInsert(int id, ROBOTTYPE type, STATE state) {
+    m_root = splay(m_root, id);
+    if (m_root != nullptr && m_root->getID() == id) {
+        if (m_root->m_deleted) {
+            revive(m_root, type, state);
+            updateSize(m_root);
+        }
+        return;  // Duplicate ID, the robot already in the tree is now the root
+    }
+
+    Robot* newRobot = pool()->allocate(id, type, state);
+    if (m_root != nullptr) {
+        if (id < m_root->getID()) {
+            newRobot->m_left = m_root->m_left;
+            newRobot->m_right = m_root;
+            m_root->m_left = nullptr;
+        } else {
+            newRobot->m_right = m_root->m_right;
+            newRobot->m_left = m_root;
+            m_root->m_right = nullptr;
+        }
+        updateSize(m_root);
+        updateSize(newRobot);
+    }
+    m_root = newRobot;
+    tally(newRobot, 1);
+    if (m_index != nullptr) {
+        m_index->set(newRobot);
+    }
+}
+
+// Helper function for insertion - Iterative BST insertion, balance only if AVL.
+// Returns false without linking newRobot if its ID is already in the tree; a
+// tombstone with that ID takes on newRobot's fields and is live again.
+bool Swarm::insertHelper(Robot* newRobot) {
+    int id = newRobot->getID();
+    if (m_shared) {
+        Robot* existing = search(id);
+        if (existing != nullptr && !existing->m_deleted) {
+            return false;  // Duplicate ID, nothing needs copying
+        }
+        ownPathTo(id);
+    }
+
+    RobotStack path;  // Nodes from the root down to the insert position
+    Robot* node = m_root;
+
+    while (node != nullptr) {
+        if (id == node->getID()) {
+            if (node->m_deleted) {
+                revive(node, newRobot->m_type, newRobot->m_state);
+                node->m_size++;
+                while (!path.empty()) {
+                    path.pop()->m_size++;
+                }
+            }
+            return false;  // Duplicate ID
+        }
+        path.push(node);
+        node = (id < node->getID()) ? node->m_left : node->m_right;
+    }
+
+    replaceChild(path.empty() ? nullptr : path.top(), newRobot);
+    rebalancePath(path);
+    tally(newRobot, 1);
+    if (m_index != nullptr) {
+        m_index->set(newRobot);
+    }
+    return true;
+}
+
+// Remove function - Remove a node with given ID
+void Swarm::remove(int id) {
+    journal(OPREMOVE, id, DEFAULT_TYPE, DEFAULT_STATE);
+    if (m_root == nullptr) {
+        return;  // Tree is empty
+    }
+
+    if (m_lazyDelete) {
+        tombstone(id);  // No relinking, compact() unlinks it later
+    } else if (m_type == SPLAY) {
+        detach();
+        splayRemove(id);
+    } else {
+        removeHelper(id);  // Iterative removal, balances the AVL tree on the way up
+    }
+}
+
+// Splay removal - Splay the ID to the root, then join its subtrees by splaying
+// the largest node of the left subtree, which then has no right child
+void Swarm::splayRemove(int id) {
+    m_root = splay(m_root, id);
+    if (m_root->getID() != id) {
+        return;  // Node not found, the last accessed node is now the root
+    }
+
+    Robot* node = m_root;
+    if (node->m_left == nullptr) {
+        m_root = node->m_right;
+    } else {
+        m_root = splay(node->m_left, id);
+        m_root->m_right = node->m_right;
+        updateSize(m_root);
+    }
+    tally(node, -1);
+    if (m_index != nullptr) {
+        m_index->erase(id);
+    }
+    m_pool->release(node);
+}
+
+// Find function - Look up a robot by ID with an iterative descent
+const Robot* Swarm::find(int id) {
+    if (m_index != nullptr && RobotIndex::covers(id)) {
+        return m_index->get(id);  // One direct access, no descent and no splay
+    }
+
+    if (m_type == SPLAY) {
+        // Splaying brings the robot, or the last node on its search path, to the root
+        detach();
+        m_root = splay(m_root, id);
+        return (m_root != nullptr && m_root->getID() == id && !m_root->m_deleted) ? m_root : nullptr;
+    }
+
+    return locate(id);
+}
+
+// Locate function - Live robot with this ID by a plain descent, never splays
+Robot* Swarm::locate(int id) const {
+    if (m_index != nullptr && RobotIndex::covers(id)) {
+        return m_index->get(id);
+    }
+
+    Robot* node = search(id);
+    return (node != nullptr && !node->m_deleted) ? node : nullptr;
+}
+
+// Search function - Plain descent to the node with this ID, tombstones included
+Robot* Swarm::search(int id) const {
+    Robot* node = m_root;
+    while (node != nullptr && node->getID() != id) {
+        node = (id < node->getID()) ? node->m_left : node->m_right;
+    }
+    return node;
+}
+
+// Set the state of a robot in place, keeping the tallies in step
+bool Swarm::setState(int id, STATE state) {
+    Robot* node = locate(id);
+    if (node == nullptr) {
+        return false;
+    }
+    if (m_shared) {
+        node = ownPathTo(id);
+    }
+    tally(node, -1);
+    node->m_state = state;
+    tally(node, 1);
+    journal(OPUPDATE, id, node->m_type, state);  // Logged with both fields, as applyBatch replays it
+    return true;
+}
+
+// Set the type of a robot in place, keeping the tallies in step
+bool Swarm::setRobotType(int id, ROBOTTYPE type) {
+    Robot* node = locate(id);
+    if (node == nullptr) {
+        return false;
+    }
+    if (m_shared) {
+        node = ownPathTo(id);
+    }
+    tally(node, -1);
+    node->m_type = type;
+    tally(node, 1);
+    journal(OPUPDATE, id, type, node->m_state);
+    return true;
+}
+
+// Enable or disable lazy deletion. Existing tombstones stay until compact().
+void Swarm::setLazyDelete(bool lazy) {
+    m_lazyDelete = lazy;
+}
+
+// Check whether remove() tombstones robots
+bool Swarm::isLazyDelete() const {
+    return m_lazyDelete;
+}
+
+// Tombstone a robot - mark it deleted and drop it from the sizes on its
+// search path. The tree keeps its shape, so nothing is rebalanced or splayed.
+bool Swarm::tombstone(int id) {
+    if (m_shared) {
+        Robot* existing = search(id);
+        if (existing == nullptr || existing->m_deleted) {
+            return false;  // Node not found
+        }
+        ownPathTo(id);
+    }
+
+    RobotStack path;  // Nodes from the root down to the robot
+    Robot* node = m_root;
+    while (node != nullptr && node->getID() != id) {
+        path.push(node);
+        node = (id < node->getID()) ? node->m_left : node->m_right;
+    }
+    if (node == nullptr || node->m_deleted) {
+        return false;  // Node not found
+    }
+
+    tally(node, -1);
+    node->m_deleted = true;
+    node->m_size--;
+    while (!path.empty()) {
+        path.pop()->m_size--;
+    }
+    if (m_index != nullptr) {
+        m_index->erase(id);
+    }
+    return true;
+}
+
+// Bring a tombstoned node back to life with a new type and state. The caller
+// fixes the subtree sizes.
+void Swarm::revive(Robot* node, ROBOTTYPE type, STATE state) {
+    node->m_type = type;
+    node->m_state = state;
+    node->m_deleted = false;
+    tally(node, 1);
+    if (m_index != nullptr) {
+        m_index->set(node);
+    }
+}
+
+// Compact function - Unlink every tombstoned robot and rebuild a balanced
+// tree out of the rest in one O(n) pass
+void Swarm::compact() {
+    detach();
+    int count = 0;
+    Robot* list = treeToVine(m_root, count);
+
+    // Filter the sorted list, returning tombstones to the pool
+    Robot* head = nullptr;
+    Robot** tail = &head;
+    int live = 0;
+    while (list != nullptr) {
+        Robot* node = list;
+        list = list->m_right;
+        if (node->m_deleted) {
+            m_pool->release(node);
+        } else {
+            *tail = node;
+            tail = &node->m_right;
+            live++;
+        }
+    }
+    *tail = nullptr;
+    m_root = buildBalanced(head, live);
+}
+
+// Contains function - Check whether a robot with this ID is in the tree
+bool Swarm::contains(int id) {
+    if (m_index != nullptr && RobotIndex::covers(id)) {
+        return m_index->test(id);  // Answered from the presence bitmap
+    }
+    return find(id) != nullptr;
+}
+
+// Size function - Number of robots in the swarm
+int Swarm::size() const {
+    return getSize(m_root);
+}
+
+// Rank function - Count robots with an ID below id in one descent
+int Swarm::rank(int id) const {
+    int count = 0;
+    Robot* node = m_root;
+    while (node != nullptr) {
+        if (node->getID() < id) {
+            count += getSize(node->m_left) + liveCount(node);  // Node and its left subtree are all below id
+            node = node->m_right;
+        } else {
+            node = node->m_left;
+        }
+    }
+    return count;
+}
+
+// Select function - Find the robot at 0-based position k in ID order
+const Robot* Swarm::select(int k) const {
+    Robot* node = m_root;
+    while (node != nullptr) {
+        int leftSize = getSize(node->m_left);
+        if (k < leftSize) {
+            node = node->m_left;
+        } else if (k == leftSize && !node->m_deleted) {
+            return node;
+        } else {
+            k -= leftSize + liveCount(node);
+            node = node->m_right;
+        }
+    }
+    return nullptr;  // k out of range
+}
+
+// Count function - Number of robots with lo <= ID <= hi
+int Swarm::countInRange(int lo, int hi) const {
+    if (lo > hi) {
+        return 0;
+    }
+
+    // Robots at or below hi, counted like rank() but including hi itself
+    int atOrBelow = 0;
+    Robot* node = m_root;
+    while (node != nullptr) {
+        if (node->getID() <= hi) {
+            atOrBelow += getSize(node->m_left) + liveCount(node);
+            node = node->m_right;
+        } else {
+            node = node->m_left;
+        }
+    }
+    return atOrBelow - rank(lo);
+}
+
+// Count the robots of one type and state from the running tally
+int Swarm::count(ROBOTTYPE type, STATE state) const {
+    if (m_tallyStale) {
+        recountTally();
+    }
+    return m_tally[type][state];
+}
+
+// Count the robots of one type and state with lo <= ID <= hi by scanning the range
+int Swarm::countInRange(int lo, int hi, ROBOTTYPE type, STATE state) const {
+    int count = 0;
+    forEachInRange(lo, hi, [&](const Robot& robot) {
+        if (robot.getType() == type && robot.getState() == state) {
+            count++;
+        }
+    });
+    return count;
+}
+
+// Adjust the tally for a node entering (+1) or leaving (-1) the tree.
+// Tombstones already left the tally when they were marked.
+void Swarm::tally(const Robot* node, int delta) {
+    if (node->m_deleted) {
+        return;
+    }
+    m_tally[node->m_type][node->m_state] += delta;
+}
+
+// Zero every type/state tally
+void Swarm::clearTally() {
+    memset(m_tally, 0, sizeof(m_tally));
+    m_tallyStale = false;
+}
+
+// Recount the tallies with one in-order walk
+void Swarm::recountTally() const {
+    memset(m_tally, 0, sizeof(m_tally));
+    for (SwarmIterator it = begin(); it != end(); ++it) {
+        m_tally[it->m_type][it->m_state]++;
+    }
+    m_tallyStale = false;
+}
+
+// Iterator to the robot with the smallest ID
+SwarmIterator Swarm::begin() const {
+    return SwarmIterator(m_root, INT_MIN);
+}
+
+// Iterator past the robot with the largest ID
+SwarmIterator Swarm::end() const {
+    return SwarmIterator();
+}
+
+// Iterator to the first robot with ID >= id
+SwarmIterator Swarm::lowerBound(int id) const {
+    return SwarmIterator(m_root, id);
+}
+
+// Helper function for removal - Iterative BST removal, balance only if AVL.
+// A node with two children is replaced by its in-order successor node, so
+// every other Robot keeps its address unless it had to be copied away from
+// a snapshot. Returns false if the ID is absent.
+bool Swarm::removeHelper(int id) {
+    if (m_shared) {
+        if (search(id) == nullptr) {
+            return false;  // Node not found
+        }
+        ownPathTo(id);
+    }
+
+    RobotStack path;  // Nodes from the root down to the parent of the removed node
+    Robot* node = m_root;
+
+    while (node != nullptr && node->getID() != id) {
+        path.push(node);
+        node = (id < node->getID()) ? node->m_left : node->m_right;
+    }
+    if (node == nullptr) {
+        return false;  // Node not found
+    }
+
+    Robot* parent = path.empty() ? nullptr : path.top();
+    if (node->m_left == nullptr || node->m_right == nullptr) {
+        // Zero or one child, splice the child into the node's place
+        Robot* child = (node->m_left != nullptr) ? node->m_left : node->m_right;
+        if (parent == nullptr) {
+            m_root = child;
+        } else if (parent->m_left == node) {
+            parent->m_left = child;
+        } else {
+            parent->m_right = child;
+        }
+    } else {
+        // Two children case - Find the inorder successor and record the path to it
+        int slot = path.size();
+        path.push(node);
+        node->m_right = own(node->m_right);
+        Robot* successor = node->m_right;
+        while (successor->m_left != nullptr) {
+            path.push(successor);
+            successor->m_left = own(successor->m_left);
+            successor = successor->m_left;
+        }
+
+        // Unlink the successor, then move it into the removed node's position
+        Robot* successorParent = path.top();
+        if (successorParent != node) {
+            successorParent->m_left = successor->m_right;
+            successor->m_right = node->m_right;
+        }
+        successor->m_left = node->m_left;
+        successor->m_height = node->m_height;
+        replaceChild(parent, successor);
+        path.set(slot, successor);
+    }
+
+    tally(node, -1);
+    if (m_index != nullptr) {
+        m_index->erase(id);
+    }
+    m_pool->release(node);
+    rebalancePath(path);
+    return true;
+}
+
+// Walk a search path back up, refreshing heights and rebalancing AVL nodes.
+// Past the first subtree whose height did not change nothing above can be
+// unbalanced, so only subtree sizes are refreshed from there on.
+void Swarm::rebalancePath(RobotStack& path) {
+    bool settled = false;  // Heights above this point can no longer change
+    while (!path.empty()) {
+        Robot* node = path.pop();
+        updateSize(node);  // Sizes change all the way up to the root
+        if (settled) {
+            continue;
+        }
+
+        int oldHeight = node->m_height;
+        node->m_height = 1 + max(getHeight(node->m_left), getHeight(node->m_right));
+
+        // Balance the tree only if it's AVL
+        Robot* top = (m_type == AVL) ? balanceTree(node) : node;
+        if (top != node) {
+            replaceChild(path.empty() ? nullptr : path.top(), top);
+        }
+
+        if (top->m_height == oldHeight) {
+            settled = true;
+        }
+    }
+}
+
+// Link child under parent on the side its ID belongs to, or make it the root
+void Swarm::replaceChild(Robot* parent, Robot* child) {
+    if (parent == nullptr) {
+        m_root = child;
+    } else if (child->getID() < parent->getID()) {
+        parent->m_left = child;
+    } else {
+        parent->m_right = child;
+    }
+}
+
+// Splay function - Top-down splay (Sleator-Tarjan). Moves the node with the
+// given ID, or the last node on its search path, to the root in a single pass
+// from the top. Splay trees do not use m_height, so it is not maintained.
+Robot* Swarm::splay(Robot* root, int id) {
+    if (root == nullptr) {
+        return root;
+    }
+
+    Robot header;               // m_right collects the left tree, m_left the right tree
+    Robot* leftMax = &header;   // Largest node of the left tree so far
+    Robot* rightMin = &header;  // Smallest node of the right tree so far
+    Robot* node = root;
+    int leftSize = 0;           // Robots linked into the left tree so far
+    int rightSize = 0;          // Robots linked into the right tree so far
+
+    while (id != node->getID()) {
+        if (id < node->getID()) {
+            if (node->m_left == nullptr) {
+                break;  // Node not in the tree
+            }
+            // Zig-Zig (Left Left) case - rotate right first
+            if (id < node->m_left->getID()) {
+                Robot* left = node->m_left;
+                node->m_left = left->m_right;
+                left->m_right = node;
+                updateSize(node);
+                node = left;
+                if (node->m_left == nullptr) {
+                    break;
+                }
+            }
+            // Link right - node and its right subtree join the right tree
+            rightMin->m_left = node;
+            rightMin = node;
+            node = node->m_left;
+            rightSize += liveCount(rightMin) + getSize(rightMin->m_right);
+        } else {
+            if (node->m_right == nullptr) {
+                break;  // Node not in the tree
+            }
+            // Zag-Zag (Right Right) case - rotate left first
+            if (id > node->m_right->getID()) {
+                Robot* right = node->m_right;
+                node->m_right = right->m_left;
+                right->m_left = node;
+                updateSize(node);
+                node = right;
+                if (node->m_right == nullptr) {
+                    break;
+                }
+            }
+            // Link left - node and its left subtree join the left tree
+            leftMax->m_right = node;
+            leftMax = node;
+            node = node->m_right;
+            leftSize += liveCount(leftMax) + getSize(leftMax->m_left);
+        }
+    }
+
+    // The linked nodes' sizes still count what was below them on the search
+    // path. Walk down each spine assigning the size of what now hangs below.
+    leftSize += getSize(node->m_left);
+    rightSize += getSize(node->m_right);
+    node->m_size = leftSize + rightSize + liveCount(node);
+    leftMax->m_right = nullptr;
+    rightMin->m_left = nullptr;
+    for (Robot* spine = header.m_right; spine != nullptr; spine = spine->m_right) {
+        spine->m_size = leftSize;
+        leftSize -= liveCount(spine) + getSize(spine->m_left);
+    }
+    for (Robot* spine = header.m_left; spine != nullptr; spine = spine->m_left) {
+        spine->m_size = rightSize;
+        rightSize -= liveCount(spine) + getSize(spine->m_right);
+    }
+
+    // Reassemble the left tree, the splayed node and the right tree
+    leftMax->m_right = node->m_left;
+    rightMin->m_left = node->m_right;
+    node->m_left = header.m_right;
+    node->m_right = header.m_left;
+    return node;
+}
+
+// Get the current tree type (BST, AVL, SPLAY, NONE)
+TREETYPE Swarm::getType() const {
+    return m_type;
+}
+
+// Set tree type, converting the existing nodes in place when necessary
+void Swarm::setType(TREETYPE type) {
+    if (m_type == type) {
+        return;  // No change in type
+    }
+
+    if (type == NONE) {
+        clear();  // Clear the tree if changing to NONE
+    }
+    else if (type == AVL || m_type == SPLAY) {
+        // BST, SPLAY and NONE trees carry no balance guarantee, and splay trees
+        // do not keep m_height, so relink the nodes with fresh heights
+        detach();
+        rebuildBalanced();
+    }
+    // Any valid BST with correct heights is already a valid BST or SPLAY tree
+
+    // Set the new tree type
+    m_type = type;
+}
+
+// Relink every node into a perfectly balanced tree in O(n) without allocating
+void Swarm::rebuildBalanced() {
+    int count = 0;
+    Robot* list = treeToVine(m_root, count);
+    m_root = buildBalanced(list, count);
+}
+
+// Flatten a subtree into a sorted list linked through m_right. Left children
+// are rotated onto the spine as they are met, so no stack is needed.
+Robot* Swarm::treeToVine(Robot* root, int& count) {
+    Robot* head = nullptr;
+    Robot** tail = &head;
+    Robot* node = root;
+    count = 0;
+
+    while (node != nullptr) {
+        if (node->m_left != nullptr) {
+            // Right rotation: the left child becomes the new top of the spine
+            Robot* left = node->m_left;
+            node->m_left = left->m_right;
+            left->m_right = node;
+            node = left;
+        } else {
+            // Smallest remaining node, append it to the list
+            *tail = node;
+            tail = &node->m_right;
+            node = node->m_right;
+            count++;
+        }
+    }
+    return head;
+}
+
+// Build a perfectly balanced tree out of the first count nodes of a sorted
+// list, advancing list past them. Heights are set on the way back up;
+// recursion depth is log2(count).
+Robot* Swarm::buildBalanced(Robot*& list, int count) {
+    if (count <= 0) {
+        return nullptr;
+    }
+
+    Robot* left = buildBalanced(list, count / 2);
+    Robot* root = list;
+    list = list->m_right;
+
+    root->m_left = left;
+    root->m_right = buildBalanced(list, count - count / 2 - 1);
+    root->m_height = 1 + max(getHeight(root->m_left), getHeight(root->m_right));
+    updateSize(root);
+    return root;
+}
+
+// Apply a batch - Large batches are sorted by ID and merged with the
+// flattened tree in one pass. Small ones run one op at a time with a single
+// search each: in batch order for BST and AVL, where sorting costs more
+// than the cached upper levels it saves (and sorted inserts chain up in a
+// BST), and in ID order for SPLAY, whose splays get cheap on sorted access.
+// Ops on one ID take effect in batch order either way.
+void Swarm::applyBatch(SwarmOp ops[], int count) {
+    if (count <= 0) {
+        return;
+    }
+    for (int i = 0; m_journal != nullptr && i < count; i++) {
+        journal(ops[i].m_kind, ops[i].m_id, ops[i].m_type, ops[i].m_state);
+    }
+    bool merge = static_cast<long long>(count) * BATCHREBUILD >= size();
+    SwarmJournal* journaled = m_journal;
+    m_journal = nullptr;  // The batch is already logged
+
+    if (!merge && m_type != SPLAY) {
+        for (int i = 0; i < count; i++) {
+            applyOp(&ops[i]);
+        }
+        m_journal = journaled;
+        return;
+    }
+
+    // Sort plain integer keys, the ID above the batch position, rather than
+    // chasing op pointers; the position keeps the sort stable
+    vector<long long> keys(count);
+    for (int i = 0; i < count; i++) {
+        keys[i] = ops[i].m_id * (1LL << 32) + i;
+    }
+    sort(keys.begin(), keys.end());
+    vector<SwarmOp*> sorted(count);
+    for (int i = 0; i < count; i++) {
+        sorted[i] = &ops[keys[i] & 0xFFFFFFFFLL];
+    }
+
+    if (merge) {
+        mergeBatch(sorted.data(), count);
+    } else {
+        for (SwarmOp* op : sorted) {
+            applyOp(op);
+        }
+    }
+    m_journal = journaled;
+}
+
+// Apply one op of a batch with a single search. Inserts and removes read
+// their outcome off the change in size, updates write the node they find.
+void Swarm::applyOp(SwarmOp* op) {
+    int before = size();
+    if (op->m_kind == OPINSERT) {
+        emplace(op->m_id, op->m_type, op->m_state);
+        op->m_result = (size() > before) ? APPLIED : ALREADYPRESENT;
+        return;
+    }
+    if (op->m_kind == OPREMOVE) {
+        remove(op->m_id);
+        op->m_result = (size() < before) ? APPLIED : NOTFOUND;
+        return;
+    }
+
+    // find() splays a SPLAY tree, which leaves the node at the root
+    Robot* node = (m_type == SPLAY) ? const_cast<Robot*>(find(op->m_id)) : locate(op->m_id);
+    op->m_result = (node != nullptr) ? APPLIED : NOTFOUND;
+    if (node == nullptr) {
+        return;
+    }
+    if (m_shared) {
+        node = ownPathTo(op->m_id);
+    }
+    tally(node, -1);
+    node->m_type = op->m_type;
+    node->m_state = op->m_state;
+    tally(node, 1);
+}
+
+// Merge a batch sorted by ID into the tree. The tree is flattened into a
+// sorted list, each ID's ops run against its node (if any) as the list is
+// walked, and the surviving nodes are rebuilt into a balanced tree.
+// Tombstones are unlinked on the way, as by compact().
+void Swarm::mergeBatch(SwarmOp* const sorted[], int count) {
+    detach();
+    int existing = 0;
+    Robot* rest = treeToVine(m_root, existing);
+    Robot* head = nullptr;
+    Robot** tail = &head;
+    int total = 0;
+
+    int i = 0;
+    while (rest != nullptr || i < count) {
+        // Next ID to emit, from the tree or from the batch
+        int id = (rest != nullptr && (i == count || rest->getID() <= sorted[i]->m_id))
+                 ? rest->getID() : sorted[i]->m_id;
+        Robot* node = nullptr;
+        if (rest != nullptr && rest->getID() == id) {
+            node = rest;
+            rest = rest->m_right;
+        }
+        bool live = (node != nullptr && !node->m_deleted);
+
+        for (; i < count && sorted[i]->m_id == id; i++) {
+            SwarmOp* op = sorted[i];
+            if (op->m_kind == OPINSERT) {
+                op->m_result = live ? ALREADYPRESENT : APPLIED;
+                if (!live) {
+                    if (node == nullptr) {
+                        node = pool()->allocate(id, op->m_type, op->m_state);
+                    }
+                    node->m_type = op->m_type;
+                    node->m_state = op->m_state;
+                    node->m_deleted = false;
+                    tally(node, 1);
+                    live = true;
+                }
+            } else if (!live) {
+                op->m_result = NOTFOUND;
+            } else {
+                op->m_result = APPLIED;
+                tally(node, -1);
+                if (op->m_kind == OPREMOVE) {
+                    live = false;
+                } else {
+                    node->m_type = op->m_type;
+                    node->m_state = op->m_state;
+                    tally(node, 1);
+                }
+            }
+        }
+
+        if (live) {
+            node->m_left = nullptr;
+            *tail = node;
+            tail = &node->m_right;
+            total++;
+            if (m_index != nullptr) {
+                m_index->set(node);
+            }
+        } else if (node != nullptr) {
+            if (m_index != nullptr) {
+                m_index->erase(id);
+            }
+            m_pool->release(node);   // Removed by the batch, or a leftover tombstone
+        }
+    }
+    *tail = nullptr;
+    m_root = buildBalanced(head, total);
+}
+
+// Bulk load - Merge a batch of robots into the tree and rebuild it balanced.
+// Duplicate IDs keep the robot already in the tree, or the first one in the
+// batch. Costs O(n) for a sorted batch and O(n + m log m) otherwise.
+void Swarm::bulkLoad(const Robot robots[], int count) {
+    if (count <= 0) {
+        return;
+    }
+    detach();
+    for (int i = 0; m_journal != nullptr && i < count; i++) {
+        journal(OPINSERT, robots[i].getID(), robots[i].getType(), robots[i].getState());
+    }
+
+    // Copy the batch into pool nodes linked in input order, noting whether it is sorted
+    Robot* batch = nullptr;
+    Robot** tail = &batch;
+    bool sorted = true;
+    for (int i = 0; i < count; i++) {
+        Robot* node = pool()->allocate(robots[i]);
+        tally(node, 1);
+        if (i > 0 && robots[i].getID() < robots[i - 1].getID()) {
+            sorted = false;
+        }
+        *tail = node;
+        tail = &node->m_right;
+    }
+
+    if (!sorted) {
+        Robot* rest = batch;
+        batch = sortVine(rest, count);
+    }
+
+    // Merge with the current contents and relink into a balanced tree
+    int existing = 0;
+    Robot* tree = treeToVine(m_root, existing);
+    int total = 0;
+    Robot* list = mergeVines(tree, batch, total);
+    m_root = buildBalanced(list, total);
+}
+
+// Pool function - This swarm's allocator, created here if a move left it without one
+RobotPool* Swarm::pool() {
+    if (m_pool == nullptr) {
+        m_pool = new RobotPool;
+    }
+    return m_pool;
+}
+
+// Snapshot function - O(1) persistent copy sharing every node with this swarm
+Swarm Swarm::snapshot() {
+    return Swarm(this);
+}
+
+// Own function - Return node if this swarm holds the only link to it,
+// otherwise a private copy. The copy takes over this swarm's link, so the
+// caller must store the result where node was linked.
+Robot* Swarm::own(Robot* node) {
+    if (node == nullptr || node->m_refs == 1) {
+        return node;
+    }
+
+    Robot* copy = pool()->allocate(*node);
+    copy->m_left = node->m_left;
+    copy->m_right = node->m_right;
+    copy->m_height = node->m_height;
+    copy->m_size = node->m_size;
+    addRef(copy->m_left);
+    addRef(copy->m_right);
+    if (node->m_refs != REFSTICKY) {
+        node->m_refs--;
+    }
+    if (m_index != nullptr && !copy->m_deleted) {
+        m_index->set(copy);
+    }
+    return copy;
+}
+
+// Copy every shared node on the search path for id, from the root down, so
+// the path can be written. Returns the node with this ID, or nullptr.
+Robot* Swarm::ownPathTo(int id) {
+    m_root = own(m_root);
+    Robot* node = m_root;
+    while (node != nullptr && node->getID() != id) {
+        Robot*& link = (id < node->getID()) ? node->m_left : node->m_right;
+        link = own(link);
+        node = link;
+    }
+    return node;
+}
+
+// Count one more link to a node. A count that reaches REFSTICKY stays there.
+void Swarm::addRef(Robot* node) {
+    if (node != nullptr && node->m_refs != REFSTICKY) {
+        node->m_refs++;
+    }
+}
+
+// Drop this swarm's link to a subtree. Nodes left with no link are returned
+// to the pool and their children lose a link in turn; nodes still linked
+// from a snapshot are left alone, so only unshared nodes are visited.
+void Swarm::dropTree(Robot* node) {
+    RobotStack stack;
+    if (node != nullptr) {
+        stack.push(node);
+    }
+    while (!stack.empty()) {
+        node = stack.pop();
+        if (node->m_refs == REFSTICKY || --node->m_refs > 0) {
+            continue;
+        }
+        if (node->m_left != nullptr) stack.push(node->m_left);
+        if (node->m_right != nullptr) stack.push(node->m_right);
+        m_pool->release(node);
+    }
+}
+
+// Detach function - Before an operation that rewrites nodes all over the
+// tree, replace the nodes shared with snapshots by a private O(n) copy
+void Swarm::detach() {
+    if (!m_shared) {
+        return;
+    }
+    Robot* root = clone(m_root);
+    dropTree(m_root);
+    m_root = root;
+    m_shared = false;
+    if (m_index != nullptr) {
+        m_index->clear();
+        indexTree();
+    }
+}
+
+// Task pool - Worker threads for the parallel set operations. Only callers of
+// run() ever wait, never the workers, so tasks can not deadlock on each other.
+class TaskPool {
+public:
+    static TaskPool& instance() {
+        static TaskPool pool;
+        return pool;
+    }
+
+    ~TaskPool() {
+        resize(0);
+    }
+
+    // Replace the workers, must not be called while a run() is in progress
+    void resize(int workers) {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_ready.notify_all();
+        for (thread& worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+        m_stopping = false;
+        for (int i = 0; i < workers; i++) {
+            m_workers.push_back(thread(&TaskPool::work, this));
+        }
+    }
+
+    int workers() const {
+        return static_cast<int>(m_workers.size());
+    }
+
+    // Run tasks[1..count-1] on the workers and tasks[0] on the calling
+    // thread, returning once all of them have finished
+    void run(const function<void()> tasks[], int count) {
+        mutex doneMutex;
+        condition_variable doneSignal;
+        int remaining = count - 1;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            for (int i = 1; i < count; i++) {
+                const function<void()>* task = &tasks[i];
+                m_queue.push_back([task, &doneMutex, &doneSignal, &remaining]() {
+                    (*task)();
+                    lock_guard<mutex> done(doneMutex);
+                    if (--remaining == 0) {
+                        doneSignal.notify_one();
+                    }
+                });
+            }
+        }
+        m_ready.notify_all();
+
+        tasks[0]();
+        unique_lock<mutex> done(doneMutex);
+        doneSignal.wait(done, [&remaining]() { return remaining == 0; });
+    }
+
+private:
+    vector<thread> m_workers;
+    deque<function<void()>> m_queue;
+    mutex m_mutex;
+    condition_variable m_ready;
+    bool m_stopping;
+
+    TaskPool() : m_stopping(false) {
+        int cores = static_cast<int>(thread::hardware_concurrency());
+        resize(cores > 1 ? cores - 1 : 0);
+    }
+
+    // Worker loop - take tasks until the pool is resized or destroyed
+    void work() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_ready.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return;  // Stopping and nothing left to run
+                }
+                task = move(m_queue.front());
+                m_queue.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+// Set the number of threads used by set operations, including the caller
+void Swarm::setThreads(int threads) {
+    TaskPool::instance().resize(threads > 1 ? threads - 1 : 0);
+}
+
+// Split constructor - Empty swarm allocating from, and freeing into, pool
+Swarm::Swarm(TREETYPE type, RobotPool* pool)
+    : m_root(nullptr), m_type(type), m_pool(pool), m_index(nullptr),
+      m_lazyDelete(false), m_shared(false), m_journal(nullptr) {
+    clearTally();
+    m_pool->addUser();
+}
+
+// Split function - Cut the tree at id in O(log n). This swarm keeps the
+// robots below id, the returned swarm (sharing this pool) gets the rest.
+// The pool is not locked, so both halves belong to the calling thread.
+Swarm Swarm::split(int id) {
+    detach();
+    Swarm upper(m_type, pool());
+    upper.m_lazyDelete = m_lazyDelete;
+
+    Robot* right = nullptr;
+    if (m_type == SPLAY) {
+        // Splay the cut point to the root and detach one of its subtrees
+        m_root = splay(m_root, id);
+        if (m_root != nullptr && m_root->getID() < id) {
+            right = m_root->m_right;
+            m_root->m_right = nullptr;
+            updateSize(m_root);
+        } else if (m_root != nullptr) {
+            right = m_root;
+            m_root = right->m_left;
+            right->m_left = nullptr;
+            updateSize(right);
+        }
+    } else {
+        Robot* left = nullptr;
+        Robot* found = splitTree(m_root, id, left, right);
+        if (found != nullptr) {
+            right = joinTrees(nullptr, found, right);
+        }
+        m_root = left;
+    }
+    upper.m_root = right;
+
+    // The moved robots leave this swarm's index, tallies and journal
+    if (m_index != nullptr || m_journal != nullptr) {
+        for (SwarmIterator it = upper.begin(); it != upper.end(); ++it) {
+            if (m_index != nullptr) {
+                m_index->erase(it->getID());
+            }
+            journal(OPREMOVE, it->getID(), DEFAULT_TYPE, DEFAULT_STATE);
+        }
+    }
+    m_tallyStale = true;
+    upper.m_tallyStale = true;
+    return upper;
+}
+
+// Join function - Move all of other's robots into this swarm. When every ID
+// of one swarm is below every ID of the other the trees are concatenated in
+// O(log n); otherwise this is unionWith followed by clearing other.
+void Swarm::join(Swarm& other) {
+    if (&other == this || other.m_root == nullptr) {
+        return;
+    }
+    detach();
+    other.detach();
+
+    // ID range of each tree, tombstones included since they still take part in the order
+    Robot* lowest = m_root;
+    Robot* highest = m_root;
+    Robot* otherLowest = other.m_root;
+    Robot* otherHighest = other.m_root;
+    while (lowest != nullptr && lowest->m_left != nullptr) lowest = lowest->m_left;
+    while (highest != nullptr && highest->m_right != nullptr) highest = highest->m_right;
+    while (otherLowest->m_left != nullptr) otherLowest = otherLowest->m_left;
+    while (otherHighest->m_right != nullptr) otherHighest = otherHighest->m_right;
+
+    bool otherAbove = (m_root == nullptr || highest->getID() < otherLowest->getID());
+    bool otherBelow = (m_root != nullptr && otherHighest->getID() < lowest->getID());
+    if (!otherAbove && !otherBelow) {
+        unionWith(other);
+        other.clear();
+        return;
+    }
+
+    // Heights must be valid and, for an AVL swarm, balanced on both sides
+    if (m_type != SPLAY && (other.m_type == SPLAY || (m_type == AVL && other.m_type != AVL))) {
+        other.rebuildBalanced();
+    }
+
+    if (m_tallyStale || other.m_tallyStale) {
+        m_tallyStale = true;
+    } else {
+        for (int type = 0; type < TYPECOUNT; type++) {
+            for (int state = 0; state < STATECOUNT; state++) {
+                m_tally[type][state] += other.m_tally[type][state];
+            }
+        }
+    }
+
+    // The nodes must come from this swarm's pool, or from slabs it takes over
+    Robot* tree = other.m_root;
+    if (other.m_pool != m_pool && other.m_pool->users() > 1) {
+        tree = clone(other.m_root);  // Other's pool is kept alive by other swarms
+        other.clear();
+    } else if (other.m_pool != m_pool) {
+        pool()->adopt(*other.m_pool);
+    }
+    other.m_root = nullptr;
+    other.clearTally();
+    other.journal(JOURNALCLEAR, DEFAULT_ID, DEFAULT_TYPE, DEFAULT_STATE);
+    if (other.m_index != nullptr) {
+        other.m_index->clear();
+    }
+    if (m_index != nullptr || m_journal != nullptr) {
+        for (SwarmIterator it(tree, INT_MIN); it != end(); ++it) {
+            if (m_index != nullptr) {
+                m_index->set(const_cast<Robot*>(&*it));
+            }
+            journal(OPINSERT, it->getID(), it->getType(), it->getState());
+        }
+    }
+
+    Robot* left = otherAbove ? m_root : tree;
+    Robot* right = otherAbove ? tree : m_root;
+    if (m_type == SPLAY) {
+        // Splay the largest robot of the left tree to its root and hang the right tree there
+        if (left == nullptr) {
+            m_root = right;
+        } else {
+            m_root = splay(left, INT_MAX);
+            m_root->m_right = right;
+            updateSize(m_root);
+        }
+    } else {
+        m_root = joinTrees(left, right);
+    }
+}
+
+// Union function - Add every robot of other not already in this swarm
+void Swarm::unionWith(const Swarm& other) {
+    if (&other != this) {
+        applySetOp(other, SETUNION);
+    }
+}
+
+// Intersection function - Keep only the robots whose ID is also in other
+void Swarm::intersectWith(const Swarm& other) {
+    if (&other != this) {
+        applySetOp(other, SETINTERSECT);
+    }
+}
+
+// Difference function - Drop every robot whose ID is in other
+void Swarm::difference(const Swarm& other) {
+    if (&other == this) {
+        clear();
+    } else {
+        applySetOp(other, SETDIFFERENCE);
+    }
+}
+
+// Run a set operation. Other is frozen into a balanced read-only copy, then
+// split at evenly spaced IDs into pieces; this tree is split at the same IDs.
+// Each piece is combined on its own thread and the results are joined back
+// in order. Tasks never touch the pool or the index: nodes copied from other
+// are allocated up front and dropped nodes are released afterwards.
+void Swarm::applySetOp(const Swarm& other, SetOp op) {
+    if (other.size() == 0 && op == SETINTERSECT) {
+        clear();
+        return;
+    }
+    if (other.size() == 0 || (m_root == nullptr && op != SETUNION)) {
+        return;
+    }
+    detach();
+    if (m_type == SPLAY) {
+        rebuildBalanced();  // The joins need valid heights
+    }
+
+    FrozenSwarm frozen(other);
+    TaskPool& pool = TaskPool::instance();
+    int pieces = 1;
+    if (size() + frozen.size() >= PARALLELCUTOFF) {
+        pieces = min(pool.workers() + 1, frozen.size());
+    }
+
+    // Cut both swarms at the same IDs, from the top down
+    SetPiece* piece = new SetPiece[pieces];
+    Robot* rest = m_root;
+    long long hi = INT_MAX;
+    for (int i = pieces - 1; i >= 0; i--) {
+        long long lo = (i == 0) ? INT_MIN : other.select(i * (other.size() / pieces))->getID();
+        piece[i].m_lo = lo;
+        piece[i].m_hi = hi;
+        piece[i].m_spare = nullptr;
+        if (i == 0) {
+            piece[i].m_tree = rest;
+        } else {
+            Robot* left = nullptr;
+            Robot* right = nullptr;
+            Robot* found = splitTree(rest, static_cast<int>(lo), left, right);
+            piece[i].m_tree = (found != nullptr) ? joinTrees(nullptr, found, right) : right;
+            rest = left;
+        }
+        if (op == SETUNION) {
+            // One spare node for every robot of other in the piece's range
+            int needed = other.countInRange(static_cast<int>(lo), static_cast<int>(hi));
+            for (int j = 0; j < needed; j++) {
+                Robot* node = this->pool()->allocate(DEFAULT_ID, DEFAULT_TYPE, DEFAULT_STATE);
+                node->m_right = piece[i].m_spare;
+                piece[i].m_spare = node;
+            }
+        }
+        hi = lo - 1;
+    }
+    m_root = nullptr;
+
+    function<void()>* tasks = new function<void()>[pieces];
+    for (int i = 0; i < pieces; i++) {
+        SetPiece* target = &piece[i];
+        tasks[i] = [this, target, &frozen, op]() {
+            target->m_tree = setOpHelper(target->m_tree, frozen, 1, target->m_lo, target->m_hi, op, *target);
+        };
+    }
+    pool.run(tasks, pieces);
+    delete[] tasks;
+
+    // Join the pieces back in ID order and return unused nodes to the pool
+    for (int i = 0; i < pieces; i++) {
+        m_root = joinTrees(m_root, piece[i].m_tree);
+        while (!piece[i].m_garbage.empty()) {
+            clearHelper(piece[i].m_garbage.pop());
+        }
+        while (piece[i].m_spare != nullptr) {
+            Robot* node = piece[i].m_spare;
+            piece[i].m_spare = node->m_right;
+            m_pool->release(node);
+        }
+    }
+    delete[] piece;
+
+    m_tallyStale = true;
+    if (m_index != nullptr) {
+        m_index->clear();
+        indexTree();
+    }
+    journalContents();
+}
+
+// Combine a subtree of this swarm with the robots of other in slot's subtree
+// whose IDs lie in [lo, hi]. The recursion follows the balanced frozen copy,
+// so it is only O(log m) deep; this tree is split at each of its IDs.
+Robot* Swarm::setOpHelper(Robot* tree, const FrozenSwarm& other, int slot,
+                          long long lo, long long hi, SetOp op, SetPiece& piece) {
+    // Skip down to the first slot inside the range
+    while (slot <= other.size() && (other.getID(slot) < lo || other.getID(slot) > hi)) {
+        slot = 2 * slot + (other.getID(slot) < lo ? 1 : 0);
+    }
+    if (slot > other.size()) {
+        if (op == SETINTERSECT && tree != nullptr) {
+            piece.m_garbage.push(tree);  // Nothing in other matches this subtree
+            return nullptr;
+        }
+        return tree;
+    }
+    if (tree == nullptr && op != SETUNION) {
+        return nullptr;
+    }
+
+    int id = other.getID(slot);
+    Robot* left = nullptr;
+    Robot* right = nullptr;
+    Robot* found = splitTree(tree, id, left, right);
+    left = setOpHelper(left, other, 2 * slot, lo, id - 1LL, op, piece);
+    right = setOpHelper(right, other, 2 * slot + 1, id + 1LL, hi, op, piece);
+
+    if (op == SETUNION) {
+        if (found == nullptr) {
+            // Copy the robot from other into a spare node
+            found = piece.m_spare;
+            piece.m_spare = found->m_right;
+            found->m_id = id;
+            found->m_type = other.getType(slot);
+            found->m_state = other.getState(slot);
+            found->m_right = nullptr;
+        } else if (found->m_deleted) {
+            // A tombstone takes on the robot from other
+            found->m_type = other.getType(slot);
+            found->m_state = other.getState(slot);
+            found->m_deleted = false;
+        }
+        return joinTrees(left, found, right);
+    }
+    if (op == SETINTERSECT && found != nullptr) {
+        return joinTrees(left, found, right);
+    }
+    if (found != nullptr) {
+        piece.m_garbage.push(found);  // Difference drops the robot
+    }
+    return joinTrees(left, right);
+}
+
+// Recompute a node's height from its children
+void Swarm::updateHeight(Robot* node) {
+    node->m_height = 1 + max(getHeight(node->m_left), getHeight(node->m_right));
+}
+
+// Join by height - Link left < mid < right into one tree. The shorter tree
+// and mid are hung on the spine of the taller one at the matching height,
+// then the spine is rebalanced upwards, costing O(height difference).
+Robot* Swarm::joinTrees(Robot* left, Robot* mid, Robot* right) {
+    int leftHeight = getHeight(left);
+    int rightHeight = getHeight(right);
+    RobotStack path;
+
+    if (leftHeight > rightHeight + 1) {
+        // Walk down the right spine of the left tree
+        Robot* node = left;
+        while (getHeight(node) > rightHeight + 1) {
+            path.push(node);
+            node = node->m_right;
+        }
+        mid->m_left = node;
+        mid->m_right = right;
+        updateHeight(mid);
+        updateSize(mid);
+        return climb(path, mid, true);
+    }
+    if (rightHeight > leftHeight + 1) {
+        // Walk down the left spine of the right tree
+        Robot* node = right;
+        while (getHeight(node) > leftHeight + 1) {
+            path.push(node);
+            node = node->m_left;
+        }
+        mid->m_left = left;
+        mid->m_right = node;
+        updateHeight(mid);
+        updateSize(mid);
+        return climb(path, mid, false);
+    }
+
+    mid->m_left = left;
+    mid->m_right = right;
+    updateHeight(mid);
+    updateSize(mid);
+    return mid;
+}
+
+// Join two trees with every ID of left below every ID of right, using the
+// largest node of left as the middle
+Robot* Swarm::joinTrees(Robot* left, Robot* right) {
+    if (left == nullptr) {
+        return right;
+    }
+    if (right == nullptr) {
+        return left;
+    }
+
+    // Unlink the largest node of left and rebalance its spine
+    RobotStack path;
+    Robot* node = left;
+    while (node->m_right != nullptr) {
+        path.push(node);
+        node = node->m_right;
+    }
+    left = climb(path, node->m_left, true);
+    return joinTrees(left, node, right);
+}
+
+// Hang sub under the nodes of path, deepest first, as their right (or left)
+// child, refreshing and rebalancing each one. Returns the new top.
+Robot* Swarm::climb(RobotStack& path, Robot* sub, bool rightSide) {
+    while (!path.empty()) {
+        Robot* parent = path.pop();
+        if (rightSide) {
+            parent->m_right = sub;
+        } else {
+            parent->m_left = sub;
+        }
+        updateHeight(parent);
+        updateSize(parent);
+        sub = balanceTree(parent);
+    }
+    return sub;
+}
+
+// Split by height - Cut a tree into the nodes below id and those above it,
+// returning the node with id itself (unlinked) or nullptr. The search path is
+// taken apart bottom-up, joining each node with its far subtree onto the
+// matching side; the join costs telescope to O(log n) for an AVL tree.
+Robot* Swarm::splitTree(Robot* root, int id, Robot*& left, Robot*& right) {
+    RobotStack path;
+    Robot* node = root;
+    while (node != nullptr && node->getID() != id) {
+        path.push(node);
+        node = (id < node->getID()) ? node->m_left : node->m_right;
+    }
+
+    Robot* found = node;
+    left = (found != nullptr) ? found->m_left : nullptr;
+    right = (found != nullptr) ? found->m_right : nullptr;
+    if (found != nullptr) {
+        found->m_left = nullptr;
+        found->m_right = nullptr;
+        found->m_height = DEFAULT_HEIGHT;
+        updateSize(found);
+    }
+
+    while (!path.empty()) {
+        node = path.pop();
+        if (id < node->getID()) {
+            right = joinTrees(right, node, node->m_right);
+        } else {
+            left = joinTrees(node->m_left, node, left);
+        }
+    }
+    return found;
+}
+
+// Checkpoint file layout (all fields little-endian):
+//   0   "SWRM"           magic
+//   4   uint32           format version
+//   8   uint32           tree type
+//   12  uint32           robot count n
+//   16  int32[n]         IDs in ascending order
+//   .   uint8[n]         type | state << 4
+//   .   uint32           FNV-1a checksum of everything before it
+static const unsigned char SAVEMAGIC[4] = {'S', 'W', 'R', 'M'};
+static const unsigned int SAVEVERSION = 1;
+static const int SAVEHEADER = 16;
+
+// Append and read back a 32-bit little-endian word
+static void putWord(unsigned char* out, unsigned int word) {
+    out[0] = static_cast<unsigned char>(word);
+    out[1] = static_cast<unsigned char>(word >> 8);
+    out[2] = static_cast<unsigned char>(word >> 16);
+    out[3] = static_cast<unsigned char>(word >> 24);
+}
+
+static unsigned int getWord(const unsigned char* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<unsigned int>(in[3]) << 24);
+}
+
+// 32-bit FNV-1a hash
+static unsigned int checksum(const unsigned char* data, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Save function - Serialize the live robots in ID order into one buffer
+// and write it with a single call
+bool Swarm::save(const string& path) const {
+    int n = size();
+    size_t length = SAVEHEADER + static_cast<size_t>(n) * 5 + 4;
+    vector<unsigned char> buffer(length);
+    unsigned char* ids = &buffer[SAVEHEADER];
+    unsigned char* codes = ids + static_cast<size_t>(n) * 4;
+
+    memcpy(&buffer[0], SAVEMAGIC, 4);
+    putWord(&buffer[4], SAVEVERSION);
+    putWord(&buffer[8], static_cast<unsigned int>(m_type));
+    putWord(&buffer[12], static_cast<unsigned int>(n));
+    int i = 0;
+    for (const Robot& robot : *this) {
+        putWord(ids + i * 4, static_cast<unsigned int>(robot.getID()));
+        codes[i] = static_cast<unsigned char>(robot.getType() | (robot.getState() << 4));
+        i++;
+    }
+    putWord(&buffer[length - 4], checksum(&buffer[0], length - 4));
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(&buffer[0], 1, length, file) == length;
+    return (fclose(file) == 0) && written;
+}
+
+// Load function - Read the whole file, verify it, then build the tree
+// straight from the sorted records: nodes are linked into a sorted list and
+// handed to buildBalanced, so nothing is searched or rotated.
+bool Swarm::load(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+    }
+    vector<unsigned char> buffer(length > 0 ? length : 0);
+    bool read = length >= SAVEHEADER + 4 && fseek(file, 0, SEEK_SET) == 0
+                && fread(&buffer[0], 1, length, file) == static_cast<size_t>(length);
+    fclose(file);
+    if (!read || memcmp(&buffer[0], SAVEMAGIC, 4) != 0 || getWord(&buffer[4]) != SAVEVERSION) {
+        return false;
+    }
+
+    unsigned int type = getWord(&buffer[8]);
+    unsigned int n = getWord(&buffer[12]);
+    if (type > SPLAY || n > static_cast<unsigned int>(INT_MAX)
+        || static_cast<size_t>(length) != SAVEHEADER + static_cast<size_t>(n) * 5 + 4
+        || getWord(&buffer[length - 4]) != checksum(&buffer[0], length - 4)) {
+        return false;
+    }
+    const unsigned char* ids = &buffer[SAVEHEADER];
+    const unsigned char* codes = ids + static_cast<size_t>(n) * 4;
+    long long last = INT_MIN - 1LL;  // Any ID the swarm accepted may have been saved
+    for (unsigned int i = 0; i < n; i++) {
+        int id = static_cast<int>(getWord(ids + i * 4));
+        if (id <= last || (codes[i] & 15) >= TYPECOUNT || (codes[i] >> 4) >= STATECOUNT) {
+            return false;  // Out of order or not a valid type/state
+        }
+        last = id;
+    }
+
+    clear();
+    m_type = static_cast<TREETYPE>(type);
+    Robot* head = nullptr;
+    Robot** tail = &head;
+    for (unsigned int i = 0; i < n; i++) {
+        Robot* node = pool()->allocate(static_cast<int>(getWord(ids + i * 4)),
+                                       static_cast<ROBOTTYPE>(codes[i] & 15),
+                                       static_cast<STATE>(codes[i] >> 4));
+        tally(node, 1);
+        if (m_index != nullptr) {
+            m_index->set(node);
+        }
+        *tail = node;
+        tail = &node->m_right;
+    }
+    *tail = nullptr;
+    m_root = buildBalanced(head, static_cast<int>(n));
+    journalContents();
+    return true;
+}
+
+// Journal file layout: a sequence of blocks, one per group commit.
+//   0   uint32           record bytes b (a multiple of JOURNALRECORD)
+//   4   uint32           FNV-1a checksum of the records
+//   8   b bytes          records: kind, type | state << 4, two zero bytes, int32 ID
+// A block cut short by a crash fails its length or checksum test, and it
+// and everything after it is ignored.
+static const int JOURNALHEADER = 8;
+static const int JOURNALRECORD = 8;
+
+// Read a journal file in one call. The records of its intact blocks are
+// returned concatenated, and valid is set to the length of the intact
+// prefix. A missing file is an empty journal.
+static bool readJournal(const string& path, vector<unsigned char>& records, long& valid) {
+    records.clear();
+    valid = 0;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return errno == ENOENT;
+    }
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+    }
+    vector<unsigned char> buffer(length > 0 ? length : 0);
+    bool read = length >= 0 && fseek(file, 0, SEEK_SET) == 0
+                && (length == 0 || fread(&buffer[0], 1, length, file) == static_cast<size_t>(length));
+    fclose(file);
+    if (!read) {
+        return false;
+    }
+
+    while (valid + JOURNALHEADER <= length) {
+        unsigned int bytes = getWord(&buffer[valid]);
+        if (bytes == 0 || bytes % JOURNALRECORD != 0 || bytes > static_cast<unsigned long>(length - valid - JOURNALHEADER)
+            || getWord(&buffer[valid + 4]) != checksum(&buffer[valid + JOURNALHEADER], bytes)) {
+            break;  // Torn or damaged block
+        }
+        records.insert(records.end(), &buffer[valid + JOURNALHEADER], &buffer[valid + JOURNALHEADER] + bytes);
+        valid += JOURNALHEADER + bytes;
+    }
+    return true;
+}
+
+// SwarmJournal class definition
+// Group-committing log writer. The owning swarm appends records to the
+// active buffer under a mutex; the flusher thread swaps buffers, writes the
+// full one as a single block and fsyncs it, so neither write nor fsync is
+// on the path of a swarm operation. Each buffer keeps JOURNALHEADER bytes
+// in front of its records for the block header.
+class SwarmJournal {
+public:
+    // Open path for appending after its intact prefix, or return nullptr
+    static SwarmJournal* open(const string& path) {
+        vector<unsigned char> records;
+        long valid = 0;
+        if (!readJournal(path, records, valid)) {
+            return nullptr;
+        }
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            return nullptr;
+        }
+        if (ftruncate(fd, valid) != 0) {  // Drop a torn tail before appending
+            ::close(fd);
+            return nullptr;
+        }
+        return new SwarmJournal(fd);
+    }
+
+    // Destructor - Commit the last group, then stop the flusher
+    ~SwarmJournal() {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_flusher.join();
+        ::close(m_fd);
+    }
+
+    // Append one record; wakes the flusher for the first record of a group
+    // and when the group reaches JOURNALBATCH records
+    void append(int kind, int id, ROBOTTYPE type, STATE state) {
+        lock_guard<mutex> lock(m_mutex);
+        size_t at = m_active.size();
+        m_active.resize(at + JOURNALRECORD);
+        m_active[at] = static_cast<unsigned char>(kind);
+        m_active[at + 1] = static_cast<unsigned char>(type | (state << 4));
+        m_active[at + 2] = 0;
+        m_active[at + 3] = 0;
+        putWord(&m_active[at + 4], static_cast<unsigned int>(id));
+        m_appended++;
+        if (at == JOURNALHEADER || at == JOURNALHEADER + (JOURNALBATCH - 1) * JOURNALRECORD) {
+            m_wake.notify_one();
+        }
+    }
+
+    // Force a group commit and wait for it. False if any write failed.
+    bool sync() {
+        unique_lock<mutex> lock(m_mutex);
+        unsigned long long target = m_appended;
+        m_syncRequested = true;
+        m_wake.notify_one();
+        m_durableSignal.wait(lock, [this, target]() { return m_durable >= target; });
+        return !m_failed;
+    }
+
+    // Empty the file once everything is committed, after a checkpoint
+    bool truncate() {
+        if (!sync()) {
+            return false;
+        }
+        lock_guard<mutex> lock(m_mutex);
+        return ftruncate(m_fd, 0) == 0;
+    }
+
+private:
+    int m_fd;
+    mutex m_mutex;
+    condition_variable m_wake;           // Flusher waits here for work
+    condition_variable m_durableSignal;  // sync() waits here for the flusher
+    vector<unsigned char> m_active;      // Header space plus records being appended
+    vector<unsigned char> m_writing;     // Buffer the flusher is writing out
+    unsigned long long m_appended;       // Records appended so far
+    unsigned long long m_durable;        // Records committed so far
+    bool m_syncRequested;
+    bool m_stopping;
+    bool m_failed;
+    thread m_flusher;
+
+    explicit SwarmJournal(int fd)
+        : m_fd(fd), m_active(JOURNALHEADER), m_appended(0), m_durable(0),
+          m_syncRequested(false), m_stopping(false), m_failed(false) {
+        m_flusher = thread(&SwarmJournal::run, this);
+    }
+
+    size_t pending() const {
+        return (m_active.size() - JOURNALHEADER) / JOURNALRECORD;
+    }
+
+    // Flusher loop - Sleep until a group starts, give it up to
+    // JOURNALINTERVAL ms to fill (less if it fills or a sync asks), then
+    // write and fsync it as one block
+    void run() {
+        unique_lock<mutex> lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [this]() { return m_stopping || m_syncRequested || pending() > 0; });
+            m_wake.wait_for(lock, chrono::milliseconds(JOURNALINTERVAL), [this]() {
+                return m_stopping || m_syncRequested || pending() >= static_cast<size_t>(JOURNALBATCH);
+            });
+            m_syncRequested = false;
+            if (pending() == 0) {
+                m_durableSignal.notify_all();
+                if (m_stopping) {
+                    return;
+                }
+                continue;
+            }
+
+            m_writing.swap(m_active);
+            m_active.assign(JOURNALHEADER, 0);
+            unsigned long long committed = m_appended;
+            lock.unlock();
+
+            size_t bytes = m_writing.size() - JOURNALHEADER;
+            putWord(&m_writing[0], static_cast<unsigned int>(bytes));
+            putWord(&m_writing[4], checksum(&m_writing[JOURNALHEADER], bytes));
+            bool ok = true;
+            for (size_t done = 0; ok && done < m_writing.size(); ) {
+                ssize_t written = ::write(m_fd, &m_writing[done], m_writing.size() - done);
+                ok = written > 0 || (written < 0 && errno == EINTR);
+                done += (written > 0) ? written : 0;
+            }
+            ok = ok && fdatasync(m_fd) == 0;
+
+            lock.lock();
+            m_failed = m_failed || !ok;
+            m_durable = committed;
+            m_durableSignal.notify_all();
+        }
+    }
+};
+
+// Journal function - Append a record if journaling is on
+void Swarm::journal(int kind, int id, ROBOTTYPE type, STATE state) {
+    if (m_journal != nullptr) {
+        m_journal->append(kind, id, type, state);
+    }
+}
+
+// Journal the whole swarm as a clear followed by one insert per live robot,
+// after an operation that replaced the contents wholesale
+void Swarm::journalContents() {
+    if (m_journal == nullptr) {
+        return;
+    }
+    journal(JOURNALCLEAR, DEFAULT_ID, DEFAULT_TYPE, DEFAULT_STATE);
+    for (SwarmIterator it = begin(); it != end(); ++it) {
+        journal(OPINSERT, it->getID(), it->getType(), it->getState());
+    }
+}
+
+// Start journaling to path, appending after the records it already holds
+bool Swarm::openJournal(const string& path) {
+    closeJournal();
+    m_journal = SwarmJournal::open(path);
+    return m_journal != nullptr;
+}
+
+// Stop journaling, committing what is buffered
+void Swarm::closeJournal() {
+    delete m_journal;
+    m_journal = nullptr;
+}
+
+// Block until every record appended so far is committed
+bool Swarm::syncJournal() {
+    return m_journal == nullptr || m_journal->sync();
+}
+
+// Checkpoint function - Commit the journal, save to a temporary file, fsync
+// it, rename it over path and fsync the directory so the rename is durable,
+// then empty the journal. A crash before the journal is emptied leaves a
+// journal whose replay on top of the new checkpoint gives the same swarm:
+// every record sets or removes one ID, and after the last removal of an ID
+// only its own later records matter.
+bool Swarm::checkpoint(const string& path) {
+    if (!syncJournal()) {
+        return false;
+    }
+    string temporary = path + ".tmp";
+    if (!save(temporary)) {
+        return false;
+    }
+    int fd = ::open(temporary.c_str(), O_RDONLY);
+    bool synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!synced || rename(temporary.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    size_t slash = path.find_last_of('/');
+    string directory = (slash == string::npos) ? "." : (slash == 0) ? "/" : path.substr(0, slash);
+    fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!synced) {
+        return false;  // The journal still holds every record
+    }
+    return m_journal == nullptr || m_journal->truncate();
+}
+
+// Recover function - Load the checkpoint, then replay the journal. Records
+// between clears go through applyBatch, so replay costs one sort and at
+// most one rebuild per run instead of a descent per record. Nothing
+// replayed is journaled again.
+bool Swarm::recover(const string& checkpointPath, const string& journalPath) {
+    vector<unsigned char> records;
+    long valid = 0;
+    if (!readJournal(journalPath, records, valid)) {
+        return false;
+    }
+    FILE* probe = fopen(checkpointPath.c_str(), "rb");
+    if (probe == nullptr && errno != ENOENT) {
+        return false;
+    }
+    SwarmJournal* journaled = m_journal;
+    m_journal = nullptr;
+    bool loaded = true;
+    if (probe != nullptr) {
+        fclose(probe);
+        loaded = load(checkpointPath);
+    } else {
+        clear();  // No checkpoint yet, the journal holds the whole history
+    }
+
+    vector<SwarmOp> ops;
+    size_t count = loaded ? records.size() / JOURNALRECORD : 0;
+    for (size_t i = 0; i <= count; i++) {
+        const unsigned char* record = (i < count) ? &records[i * JOURNALRECORD] : nullptr;
+        if (record == nullptr || record[0] == JOURNALCLEAR) {
+            applyBatch(ops.data(), static_cast<int>(ops.size()));
+            ops.clear();
+            if (record != nullptr) {
+                clear();
+            }
+        } else if (record[0] <= OPUPDATE) {
+            ops.push_back(SwarmOp(static_cast<OPKIND>(record[0]), static_cast<int>(getWord(record + 4)),
+                                  static_cast<ROBOTTYPE>(record[1] & 15), static_cast<STATE>(record[1] >> 4)));
+        }
+    }
+    m_journal = journaled;
+    return loaded;
+}
+
+// Freeze function - Copy the tree into an immutable Eytzinger layout snapshot
+FrozenSwarm Swarm::freeze() const {
+    return FrozenSwarm(*this);
+}
+
+// Stable merge sort of the first count nodes of a list linked through m_right,
+// advancing list past them. Recursion depth is log2(count).
+Robot* Swarm::sortVine(Robot*& list, int count) {
+    if (count == 1) {
+        Robot* node = list;
+        list = list->m_right;
+        node->m_right = nullptr;
+        return node;
+    }
+
+    Robot* first = sortVine(list, count / 2);
+    Robot* second = sortVine(list, count - count / 2);
+
+    // Merge, taking from first on ties to keep the sort stable
+    Robot* head = nullptr;
+    Robot** tail = &head;
+    while (first != nullptr && second != nullptr) {
+        if (second->getID() < first->getID()) {
+            *tail = second;
+            second = second->m_right;
+        } else {
+            *tail = first;
+            first = first->m_right;
+        }
+        tail = &(*tail)->m_right;
+    }
+    *tail = (first != nullptr) ? first : second;
+    return head;
+}
+
+// Merge two sorted lists into one strictly increasing list. Nodes whose ID is
+// already present are released, with first winning over second.
+Robot* Swarm::mergeVines(Robot* first, Robot* second, int& count) {
+    Robot* head = nullptr;
+    Robot** tail = &head;
+    Robot* last = nullptr;
+    count = 0;
+
+    while (first != nullptr || second != nullptr) {
+        Robot* node;
+        if (second == nullptr || (first != nullptr && first->getID() <= second->getID())) {
+            node = first;
+            first = first->m_right;
+        } else {
+            node = second;
+            second = second->m_right;
+        }
+
+        if (node->m_deleted || (last != nullptr && last->getID() == node->getID())) {
+            tally(node, -1);
+            m_pool->release(node);  // Tombstone, or duplicate ID where the earlier node wins
+            continue;
+        }
+
+        node->m_left = nullptr;
+        *tail = node;
+        tail = &node->m_right;
+        last = node;
+        count++;
+        if (m_index != nullptr) {
+            m_index->set(node);
+        }
+    }
+    *tail = nullptr;
+    return head;
+}
+
+// Clone function for deep copy (iterative), copies are allocated from this swarm's pool
+Robot* Swarm::clone(Robot* root) {
+    if (root == nullptr) {
+        return nullptr;
+    }
+
+    Robot* newRoot = pool()->allocate(*root);
+    newRoot->m_height = root->m_height;
+    newRoot->m_size = root->m_size;
+
+    // Pending (source, copy) pairs whose children still have to be copied
+    RobotStack pending;
+    pending.push(root);
+    pending.push(newRoot);
+    while (!pending.empty()) {
+        Robot* copy = pending.pop();
+        Robot* source = pending.pop();
+
+        if (source->m_left != nullptr) {
+            copy->m_left = pool()->allocate(*source->m_left);
+            copy->m_left->m_height = source->m_left->m_height;
+            copy->m_left->m_size = source->m_left->m_size;
+            pending.push(source->m_left);
+            pending.push(copy->m_left);
+        }
+        if (source->m_right != nullptr) {
+            copy->m_right = pool()->allocate(*source->m_right);
+            copy->m_right->m_height = source->m_right->m_height;
+            copy->m_right->m_size = source->m_right->m_size;
+            pending.push(source->m_right);
+            pending.push(copy->m_right);
+        }
+    }
+    return newRoot;
+}
+
+// Assignment operator for Swarm class
+const Swarm& Swarm::operator=(const Swarm& rhs) {
+    // Check for self-assignment
+    if (this != &rhs) {
+        // Clear the existing tree
+        clear();
+
+        // Deep copy the tree from the rhs (right-hand side)
+        m_type = rhs.m_type;
+        m_root = clone(rhs.m_root);  // Iteratively clone the tree
+        m_shared = false;
+        memcpy(m_tally, rhs.m_tally, sizeof(m_tally));
+        m_tallyStale = rhs.m_tallyStale;
+        m_lazyDelete = rhs.m_lazyDelete;
+
+        // Follow rhs's index setting, pointing the index at the new nodes
+        if (rhs.m_index != nullptr && m_index != nullptr) {
+            indexTree();  // clear() emptied the existing index
+        } else {
+            setIndexed(rhs.m_index != nullptr);
+        }
+        journalContents();
+    }
+    return *this;  // Return the current object
+}
+
+// Move assignment - Take over rhs's contents in O(1); this swarm's old nodes
+// go with the temporary, whose destructor drops their slabs in one sweep.
+// Each swarm keeps its own journal, which logs its new contents.
+const Swarm& Swarm::operator=(Swarm&& rhs) noexcept {
+    if (this != &rhs) {
+        Swarm old(std::move(rhs));
+        std::swap(rhs.m_journal, old.m_journal);  // The journal stays with rhs
+        swap(old);
+        std::swap(m_journal, old.m_journal);      // and this swarm keeps its own
+        rhs.journalContents();  // rhs is now empty
+        journalContents();
+    }
+    return *this;
+}
+
+// Swap function - Exchange the contents of two swarms in O(1), journals
+// included, so each journal follows the robots it describes
+void Swarm::swap(Swarm& other) noexcept {
+    std::swap(m_root, other.m_root);
+    std::swap(m_type, other.m_type);
+    std::swap(m_pool, other.m_pool);
+    std::swap(m_index, other.m_index);
+    std::swap(m_tally, other.m_tally);
+    std::swap(m_tallyStale, other.m_tallyStale);
+    std::swap(m_lazyDelete, other.m_lazyDelete);
+    std::swap(m_shared, other.m_shared);
+    std::swap(m_journal, other.m_journal);
+}
+
+// Balance the AVL tree if necessary
+Robot* Swarm::balanceTree(Robot* node) {
+    if (node == nullptr) return node;
+
+    int balanceFactor = getBalance(node);
+
+    // Left heavy case
+    if (balanceFactor > 1) {
+        if (getBalance(node->m_left) < 0) {
+            node->m_left = leftRotate(node->m_left);  // Left-right case
+        }
+        return rightRotate(node);  // Left-left case
+    }
+
+    // Right heavy case
+    if (balanceFactor < -1) {
+        if (getBalance(node->m_right) > 0) {
+            node->m_right = rightRotate(node->m_right);  // Right-left case
+        }
+        return leftRotate(node);  // Right-right case
+    }
+
+    return node;
+}
+
+// Left rotation helper function
+// Both nodes are copied first if a snapshot shares them; the caller links
+// the returned node where x was.
+Robot* Swarm::leftRotate(Robot* x) {
+    x = own(x);
+    Robot* y = x->m_right = own(x->m_right);
+    Robot* T2 = y->m_left;
+
+    y->m_left = x;
+    x->m_right = T2;
+
+    // Update heights and subtree sizes, lower node first
+    x->m_height = 1 + max(getHeight(x->m_left), getHeight(x->m_right));
+    y->m_height = 1 + max(getHeight(y->m_left), getHeight(y->m_right));
+    updateSize(x);
+    updateSize(y);
+
+    return y;
+}
+
+// Right rotation helper function
+// Both nodes are copied first if a snapshot shares them; the caller links
+// the returned node where y was.
+Robot* Swarm::rightRotate(Robot* y) {
+    y = own(y);
+    Robot* x = y->m_left = own(y->m_left);
+    Robot* T2 = x->m_right;
+
+    x->m_right = y;
+    y->m_left = T2;
+
+    // Update heights and subtree sizes, lower node first
+    y->m_height = 1 + max(getHeight(y->m_left), getHeight(y->m_right));
+    x->m_height = 1 + max(getHeight(x->m_left), getHeight(x->m_right));
+    updateSize(y);
+    updateSize(x);
+
+    return x;
+}
+
+// Get height of a node
+int Swarm::getHeight(Robot* node) const {
+    return (node == nullptr) ? -1 : node->getHeight();
+}
+
+// Get subtree size of a node
+int Swarm::getSize(Robot* node) const {
+    return (node == nullptr) ? 0 : node->m_size;
+}
+
+// Recompute a node's subtree size from its children
+void Swarm::updateSize(Robot* node) {
+    node->m_size = liveCount(node) + getSize(node->m_left) + getSize(node->m_right);
+}
+
+// Weight of a node in the subtree sizes
+int Swarm::liveCount(Robot* node) const {
+    return node->m_deleted ? 0 : 1;
+}
+
+// Get balance factor of a node
+int Swarm::getBalance(Robot* node) const {
+    return (node == nullptr) ? 0 : getHeight(node->m_left) - getHeight(node->m_right);
+}
+
+// Dump function for in-order traversal
+void Swarm::dumpTree() const {
+    exportTo(cout, EXPORTTREE);
+    cout.flush();
+}
+
+// ExportBuffer class definition
+// Output buffer for exportTo. Text is gathered in one EXPORTBUFFER-byte
+// block and handed to the stream or descriptor only when the block is
+// full, and integers are formatted by hand instead of through operator<<.
+class ExportBuffer {
+public:
+    explicit ExportBuffer(ostream* stream, int fd = -1)
+        : m_stream(stream), m_fd(fd), m_used(0), m_failed(false) {}
+
+    void put(char c) {
+        if (m_used == EXPORTBUFFER) {
+            flush();
+        }
+        m_block[m_used++] = c;
+    }
+
+    void put(const char* text) {
+        while (*text != '\0') {
+            put(*text++);
+        }
+    }
+
+    // Write the digits into a small scratch array back to front
+    void put(int value) {
+        char digits[12];
+        int length = 0;
+        unsigned int magnitude = (value < 0) ? 0u - static_cast<unsigned int>(value) : value;
+        do {
+            digits[length++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (value < 0) {
+            digits[length++] = '-';
+        }
+        if (m_used + length > EXPORTBUFFER) {
+            flush();
+        }
+        while (length > 0) {
+            m_block[m_used++] = digits[--length];
+        }
+    }
+
+    // Hand the buffered text on; returns false once any write has failed
+    bool flush() {
+        if (m_stream != nullptr) {
+            m_failed = m_failed || !m_stream->write(m_block, m_used);
+        } else {
+            for (int done = 0; !m_failed && done < m_used; ) {
+                ssize_t written = ::write(m_fd, m_block + done, m_used - done);
+                m_failed = (written < 0 && errno != EINTR) || written == 0;
+                done += (written > 0) ? static_cast<int>(written) : 0;
+            }
+        }
+        m_used = 0;
+        return !m_failed;
+    }
+
+private:
+    ostream* m_stream;   // Destination stream, or nullptr to write to m_fd
+    int m_fd;            // Destination descriptor
+    int m_used;          // Bytes in m_block
+    bool m_failed;       // A write failed
+    char m_block[EXPORTBUFFER];
+};
+
+// Names used by the JSON and CSV exports
+static const char* const TYPENAMES[TYPECOUNT] = {"BIRD", "DRONE", "REPTILE", "SUB", "QUADRUPED"};
+static const char* const STATENAMES[STATECOUNT] = {"ALIVE", "DEAD"};
+static const char* const TREENAMES[] = {"NONE", "BST", "AVL", "SPLAY"};
+
+// Export to a stream
+bool Swarm::exportTo(ostream& out, EXPORTFORMAT format) const {
+    unique_ptr<ExportBuffer> buffer(new ExportBuffer(&out));
+    return exportFormat(*buffer, format);
+}
+
+// Export to a file descriptor, which is left open
+bool Swarm::exportTo(int fd, EXPORTFORMAT format) const {
+    unique_ptr<ExportBuffer> buffer(new ExportBuffer(nullptr, fd));
+    return exportFormat(*buffer, format);
+}
+
+// Write one format into the buffer. Tombstones only show in the tree
+// format, which prints the shape; the others list the live robots.
+bool Swarm::exportFormat(ExportBuffer& out, EXPORTFORMAT format) const {
+    if (format == EXPORTTREE) {
+        dump(m_root, out);
+        out.put('\n');
+        return out.flush();
+    }
+
+    if (format == EXPORTJSON) {
+        out.put("{\"type\":\"");
+        out.put(TREENAMES[m_type]);
+        out.put("\",\"size\":");
+        out.put(size());
+        out.put(",\"robots\":[");
+    } else if (format == EXPORTCSV) {
+        out.put("id,type,state\n");
+    }
+
+    bool first = true;
+    for (const Robot& robot : *this) {
+        if (format == EXPORTIDS) {
+            out.put(robot.getID());
+            out.put('\n');
+        } else if (format == EXPORTJSON) {
+            out.put(first ? "\n{\"id\":" : ",\n{\"id\":");
+            out.put(robot.getID());
+            out.put(",\"type\":\"");
+            out.put(TYPENAMES[robot.getType()]);
+            out.put("\",\"state\":\"");
+            out.put(STATENAMES[robot.getState()]);
+            out.put("\"}");
+        } else {
+            out.put(robot.getID());
+            out.put(',');
+            out.put(TYPENAMES[robot.getType()]);
+            out.put(',');
+            out.put(STATENAMES[robot.getState()]);
+            out.put('\n');
+        }
+        first = false;
+    }
+
+    if (format == EXPORTJSON) {
+        out.put(first ? "]}\n" : "\n]}\n");
+    }
+    return out.flush();
+}
+
+// Iterative in-order dump. A nullptr pushed after a node is visited marks
+// where its closing parenthesis goes once the right subtree is printed.
+void Swarm::dump(Robot* aBot, ExportBuffer& out) const {
+    RobotStack stack;
+    Robot* node = aBot;
+
+    while (node != nullptr || !stack.empty()) {
+        if (node != nullptr) {
+            out.put('(');
+            stack.push(node);
+            node = node->m_left;  // Visit left child
+        } else {
+            Robot* top = stack.pop();
+            if (top == nullptr) {
+                out.put(')');
+            } else {
+                out.put(top->m_id);  // Visit node itself
+                out.put(':');
+                out.put(top->m_height);
+                stack.push(nullptr);
+                node = top->m_right;  // Visit right child
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CompactSwarm - index-linked node array
+// ---------------------------------------------------------------------------
+
+const unsigned int HEIGHTMASK = 0x00FFFFFFu;  // Low 24 bits of Node::m_meta
+const unsigned int TYPESHIFT = 24;            // Bits 24-26 hold the robot type
+const unsigned int STATESHIFT = 27;           // Bit 27 holds the robot state
+const unsigned int INITIALSLOTS = 64;         // First size of the node array
+
 // Constructor - Default tree type is NONE
-Swarm::Swarm() : m_root(nullptr), m_type(NONE) {}
+CompactSwarm::CompactSwarm()
+    : m_nodes(nullptr), m_capacity(0), m_used(1), m_freeList(0), m_root(0), m_type(NONE) {}
 
 // Constructor - Initialize with specific tree type
-Swarm::Swarm(TREETYPE type) : m_root(nullptr), m_type(type) {}
+CompactSwarm::CompactSwarm(TREETYPE type)
+    : m_nodes(nullptr), m_capacity(0), m_used(1), m_freeList(0), m_root(0), m_type(type) {}
+
+// Copy constructor - The node array is copied in one block
+CompactSwarm::CompactSwarm(const CompactSwarm& rhs)
+    : m_nodes(nullptr), m_capacity(0), m_used(1), m_freeList(0), m_root(0), m_type(NONE) {
+    *this = rhs;
+}
+
+// Destructor - One array holds every node
+CompactSwarm::~CompactSwarm() {
+    delete[] m_nodes;
+}
+
+// Assignment operator - Indices are position independent, so a block copy is a deep copy
+const CompactSwarm& CompactSwarm::operator=(const CompactSwarm& rhs) {
+    if (this != &rhs) {
+        // An empty rhs that never allocated has nothing to copy, and this keeps its own array
+        if (rhs.m_nodes != nullptr) {
+            if (m_capacity < rhs.m_used) {
+                delete[] m_nodes;
+                m_nodes = new Node[rhs.m_capacity];
+                m_capacity = rhs.m_capacity;
+            }
+            memcpy(m_nodes, rhs.m_nodes, rhs.m_used * sizeof(Node));
+        }
+        m_used = rhs.m_used;
+        m_freeList = rhs.m_freeList;
+        m_root = rhs.m_root;
+        m_type = rhs.m_type;
+    }
+    return *this;
+}
+
+// Clear function - Forget every node at once, the array is kept for reuse
+void CompactSwarm::clear() {
+    m_used = 1;
+    m_freeList = 0;
+    m_root = 0;
+}
+
+// Get the current tree type (BST, AVL, SPLAY, NONE)
+TREETYPE CompactSwarm::getType() const {
+    return m_type;
+}
+
+// Set tree type, relinking the nodes into a balanced tree when necessary
+void CompactSwarm::setType(TREETYPE type) {
+    if (m_type == type) {
+        return;  // No change in type
+    }
+
+    if (type == NONE) {
+        clear();
+    } else if (type == AVL || m_type == SPLAY) {
+        rebuildBalanced();  // Same rules as Swarm::setType
+    }
+    m_type = type;
+}
+
+// Take a slot off the free list, or the next unused slot, doubling the array when full
+unsigned int CompactSwarm::allocate(const Robot& robot) {
+    unsigned int node = m_freeList;
+    if (node != 0) {
+        m_freeList = m_nodes[node].m_right;
+    } else {
+        if (m_used >= m_capacity) {
+            unsigned int capacity = (m_capacity == 0) ? INITIALSLOTS : m_capacity * 2;
+            Node* nodes = new Node[capacity];
+            if (m_nodes != nullptr) {
+                memcpy(nodes, m_nodes, m_used * sizeof(Node));
+            }
+            delete[] m_nodes;
+            m_nodes = nodes;
+            m_capacity = capacity;
+        }
+        node = m_used++;
+    }
+
+    m_nodes[node].m_left = 0;
+    m_nodes[node].m_right = 0;
+    m_nodes[node].m_id = robot.getID();
+    m_nodes[node].m_meta = (static_cast<unsigned int>(robot.getType()) << TYPESHIFT)
+                           | (static_cast<unsigned int>(robot.getState()) << STATESHIFT);
+    return node;
+}
+
+// Push a slot back onto the free list
+void CompactSwarm::release(unsigned int node) {
+    m_nodes[node].m_left = 0;
+    m_nodes[node].m_right = m_freeList;
+    m_freeList = node;
+}
+
+// Get height of a node, -1 for the null link
+int CompactSwarm::getHeight(unsigned int node) const {
+    return (node == 0) ? -1 : static_cast<int>(m_nodes[node].m_meta & HEIGHTMASK);
+}
+
+// Store a height in the low 24 bits of the packed word
+void CompactSwarm::setHeight(unsigned int node, int height) {
+    m_nodes[node].m_meta = (m_nodes[node].m_meta & ~HEIGHTMASK)
+                           | (static_cast<unsigned int>(height) & HEIGHTMASK);
+}
+
+// Recompute a node's height from its children
+void CompactSwarm::updateHeight(unsigned int node) {
+    setHeight(node, 1 + max(getHeight(m_nodes[node].m_left), getHeight(m_nodes[node].m_right)));
+}
+
+// Unpack the robot type
+ROBOTTYPE CompactSwarm::getRobotType(unsigned int node) const {
+    return static_cast<ROBOTTYPE>((m_nodes[node].m_meta >> TYPESHIFT) & 7u);
+}
+
+// Unpack the robot state
+STATE CompactSwarm::getState(unsigned int node) const {
+    return static_cast<STATE>((m_nodes[node].m_meta >> STATESHIFT) & 1u);
+}
+
+// Insert function - Insert a robot into the tree
+void CompactSwarm::insert(const Robot& robot) {
+    if (m_type == SPLAY) {
+        splayInsert(robot);
+        return;
+    }
+
+    int id = robot.getID();
+    NodeStack<unsigned int> path;  // Nodes from the root down to the insert position
+    unsigned int node = m_root;
+    while (node != 0) {
+        if (id == m_nodes[node].m_id) {
+            return;  // Duplicate ID
+        }
+        path.push(node);
+        node = (id < m_nodes[node].m_id) ? m_nodes[node].m_left : m_nodes[node].m_right;
+    }
+
+    unsigned int newNode = allocate(robot);
+    replaceChild(path.empty() ? 0 : path.top(), newNode);
+    rebalancePath(path);
+}
+
+// Remove function - Remove a node with given ID
+void CompactSwarm::remove(int id) {
+    if (m_root == 0) {
+        return;  // Tree is empty
+    }
+    if (m_type == SPLAY) {
+        splayRemove(id);
+        return;
+    }
+
+    NodeStack<unsigned int> path;  // Nodes from the root down to the parent of the removed node
+    unsigned int node = m_root;
+    while (node != 0 && m_nodes[node].m_id != id) {
+        path.push(node);
+        node = (id < m_nodes[node].m_id) ? m_nodes[node].m_left : m_nodes[node].m_right;
+    }
+    if (node == 0) {
+        return;  // Node not found
+    }
+
+    unsigned int parent = path.empty() ? 0 : path.top();
+    Node& removed = m_nodes[node];
+    if (removed.m_left == 0 || removed.m_right == 0) {
+        // Zero or one child, splice the child into the node's place
+        unsigned int child = (removed.m_left != 0) ? removed.m_left : removed.m_right;
+        if (parent == 0) {
+            m_root = child;
+        } else if (m_nodes[parent].m_left == node) {
+            m_nodes[parent].m_left = child;
+        } else {
+            m_nodes[parent].m_right = child;
+        }
+    } else {
+        // Two children case - Move the inorder successor into the node's place
+        int slot = path.size();
+        path.push(node);
+        unsigned int successor = removed.m_right;
+        while (m_nodes[successor].m_left != 0) {
+            path.push(successor);
+            successor = m_nodes[successor].m_left;
+        }
+
+        unsigned int successorParent = path.top();
+        if (successorParent != node) {
+            m_nodes[successorParent].m_left = m_nodes[successor].m_right;
+            m_nodes[successor].m_right = removed.m_right;
+        }
+        m_nodes[successor].m_left = removed.m_left;
+        setHeight(successor, getHeight(node));
+        replaceChild(parent, successor);
+        path.set(slot, successor);
+    }
+
+    release(node);
+    rebalancePath(path);
+}
+
+// Find function - Copy out the robot with this ID
+bool CompactSwarm::find(int id, Robot& robot) {
+    unsigned int node = findNode(id);
+    if (node == 0) {
+        return false;
+    }
+    robot = Robot(id, getRobotType(node), getState(node));
+    robot.setHeight(getHeight(node));
+    return true;
+}
 
-// Destructor - Clear the tree
-Swarm::~Swarm() {
-    clear();
+// Contains function - Check whether a robot with this ID is in the tree
+bool CompactSwarm::contains(int id) {
+    return findNode(id) != 0;
 }
 
-// Clear function - Deallocates all memory in the tree
-void Swarm::clear() {
-    while (m_root != nullptr) {
-        remove(m_root->getID());  // Remove root until tree is empty
+// Locate a node by ID, splaying it to the root in SPLAY mode
+unsigned int CompactSwarm::findNode(int id) {
+    if (m_type == SPLAY) {
+        m_root = splay(m_root, id);
+        return (m_root != 0 && m_nodes[m_root].m_id == id) ? m_root : 0;
     }
-}
 
-// Insert function - Insert a robot into the tree
-void Swarm::insert(const Robot& robot) {
-    Robot* newRobot = new Robot(robot);  // Allocate new robot node
+    unsigned int node = m_root;
+    while (node != 0 && m_nodes[node].m_id != id) {
+        node = (id < m_nodes[node].m_id) ? m_nodes[node].m_left : m_nodes[node].m_right;
+    }
+    return node;
+}
 
-    if (m_root == nullptr) {
-        m_root = newRobot;  // Insert into empty tree
+// Link child under parent on the side its ID belongs to, or make it the root
+void CompactSwarm::replaceChild(unsigned int parent, unsigned int child) {
+    if (parent == 0) {
+        m_root = child;
+    } else if (m_nodes[child].m_id < m_nodes[parent].m_id) {
+        m_nodes[parent].m_left = child;
     } else {
-        m_root = insertHelper(m_root, newRobot);  // Recursive insertion
+        m_nodes[parent].m_right = child;
     }
+}
 
-    if (m_type == AVL) {
-        m_root = balanceTree(m_root);  // Balance the AVL tree after insertion
-    } else if (m_type == SPLAY) {
-        m_root = splay(m_root, newRobot->getID());  // Splay the new node to the root
-        // Fix: Ensure the newRobot is properly deallocated if not used
-        if (m_root != newRobot) {
-            delete newRobot;  // Prevent memory leak if splay didn't use newRobot
+// Walk a search path back up, refreshing heights and rebalancing AVL nodes,
+// until a subtree's height stops changing
+void CompactSwarm::rebalancePath(NodeStack<unsigned int>& path) {
+    while (!path.empty()) {
+        unsigned int node = path.pop();
+        int oldHeight = getHeight(node);
+        updateHeight(node);
+
+        unsigned int top = (m_type == AVL) ? balanceTree(node) : node;
+        if (top != node) {
+            replaceChild(path.empty() ? 0 : path.top(), top);
+        }
+
+        if (getHeight(top) == oldHeight) {
+            break;
         }
     }
 }
 
-// Helper function for insertion - Standard BST insertion, balance only if AVL
-Robot* Swarm::insertHelper(Robot* root, Robot* newRobot) {
-    if (root == nullptr) {
-        return newRobot;  // Insert position found
+// Balance an AVL node if necessary, returning the new subtree root
+unsigned int CompactSwarm::balanceTree(unsigned int node) {
+    int balanceFactor = getHeight(m_nodes[node].m_left) - getHeight(m_nodes[node].m_right);
+
+    // Left heavy case
+    if (balanceFactor > 1) {
+        unsigned int left = m_nodes[node].m_left;
+        if (getHeight(m_nodes[left].m_left) < getHeight(m_nodes[left].m_right)) {
+            m_nodes[node].m_left = leftRotate(left);  // Left-right case
+        }
+        return rightRotate(node);  // Left-left case
     }
 
-    // Insert to left subtree
-    if (newRobot->getID() < root->getID()) {
-        root->m_left = insertHelper(root->m_left, newRobot);
+    // Right heavy case
+    if (balanceFactor < -1) {
+        unsigned int right = m_nodes[node].m_right;
+        if (getHeight(m_nodes[right].m_left) > getHeight(m_nodes[right].m_right)) {
+            m_nodes[node].m_right = rightRotate(right);  // Right-left case
+        }
+        return leftRotate(node);  // Right-right case
     }
-    // Insert to right subtree
-    else if (newRobot->getID() > root->getID()) {
-        root->m_right = insertHelper(root->m_right, newRobot);
+
+    return node;
+}
+
+// Left rotation helper function
+unsigned int CompactSwarm::leftRotate(unsigned int x) {
+    unsigned int y = m_nodes[x].m_right;
+    m_nodes[x].m_right = m_nodes[y].m_left;
+    m_nodes[y].m_left = x;
+    updateHeight(x);
+    updateHeight(y);
+    return y;
+}
+
+// Right rotation helper function
+unsigned int CompactSwarm::rightRotate(unsigned int y) {
+    unsigned int x = m_nodes[y].m_left;
+    m_nodes[y].m_left = m_nodes[x].m_right;
+    m_nodes[x].m_right = y;
+    updateHeight(y);
+    updateHeight(x);
+    return x;
+}
+
+// Top-down splay, see Swarm::splay. Slot 0 serves as the header node.
+unsigned int CompactSwarm::splay(unsigned int root, int id) {
+    if (root == 0) {
+        return root;
     }
 
-    // Update height of current node
-    root->m_height = 1 + max(getHeight(root->m_left), getHeight(root->m_right));
+    Node& header = m_nodes[0];
+    header.m_left = 0;
+    header.m_right = 0;
+    unsigned int leftMax = 0;   // Largest node of the left tree so far
+    unsigned int rightMin = 0;  // Smallest node of the right tree so far
+    unsigned int node = root;
 
-    // Balance the tree only if it's AVL
-    if (m_type == AVL) {
-        root = balanceTree(root);
+    while (id != m_nodes[node].m_id) {
+        if (id < m_nodes[node].m_id) {
+            unsigned int left = m_nodes[node].m_left;
+            if (left == 0) {
+                break;
+            }
+            if (id < m_nodes[left].m_id) {
+                // Zig-Zig - rotate right first
+                m_nodes[node].m_left = m_nodes[left].m_right;
+                m_nodes[left].m_right = node;
+                node = left;
+                if (m_nodes[node].m_left == 0) {
+                    break;
+                }
+            }
+            // Link right
+            m_nodes[rightMin].m_left = node;
+            rightMin = node;
+            node = m_nodes[node].m_left;
+        } else {
+            unsigned int right = m_nodes[node].m_right;
+            if (right == 0) {
+                break;
+            }
+            if (id > m_nodes[right].m_id) {
+                // Zag-Zag - rotate left first
+                m_nodes[node].m_right = m_nodes[right].m_left;
+                m_nodes[right].m_left = node;
+                node = right;
+                if (m_nodes[node].m_right == 0) {
+                    break;
+                }
+            }
+            // Link left
+            m_nodes[leftMax].m_right = node;
+            leftMax = node;
+            node = m_nodes[node].m_right;
+        }
     }
 
-    return root;
+    // Reassemble, reading the header before the slot 0 links are reset
+    m_nodes[leftMax].m_right = m_nodes[node].m_left;
+    m_nodes[rightMin].m_left = m_nodes[node].m_right;
+    m_nodes[node].m_left = header.m_right;
+    m_nodes[node].m_right = header.m_left;
+    header.m_left = 0;
+    header.m_right = 0;
+    return node;
 }
 
-// Remove function - Remove a node with given ID
-void Swarm::remove(int id) {
-    if (m_root == nullptr) {
-        return;  // Tree is empty
+// Splay insertion - Splay the ID to the root, then split around a new root node
+void CompactSwarm::splayInsert(const Robot& robot) {
+    int id = robot.getID();
+    m_root = splay(m_root, id);
+    if (m_root != 0 && m_nodes[m_root].m_id == id) {
+        return;  // Duplicate ID
     }
-    m_root = removeHelper(m_root, id);  // Recursive removal
 
-    // Balance if the tree is AVL
-    if (m_type == AVL) {
-        m_root = balanceTree(m_root);
-    } else if (m_type == SPLAY && m_root != nullptr) {
-        m_root = splay(m_root, id);  // Splay the last accessed node to the root
+    unsigned int newNode = allocate(robot);
+    if (m_root != 0) {
+        Node& root = m_nodes[m_root];
+        if (id < root.m_id) {
+            m_nodes[newNode].m_left = root.m_left;
+            m_nodes[newNode].m_right = m_root;
+            root.m_left = 0;
+        } else {
+            m_nodes[newNode].m_right = root.m_right;
+            m_nodes[newNode].m_left = m_root;
+            root.m_right = 0;
+        }
     }
+    m_root = newNode;
 }
 
-// Helper function for removal - Standard BST removal
-Robot* Swarm::removeHelper(Robot* root, int id) {
-    if (root == nullptr) {
-        return nullptr;  // Node not found
+// Splay removal - Splay the ID to the root, then join its subtrees
+void CompactSwarm::splayRemove(int id) {
+    m_root = splay(m_root, id);
+    if (m_nodes[m_root].m_id != id) {
+        return;  // Node not found
     }
 
-    if (id < root->getID()) {
-        root->m_left = removeHelper(root->getLeft(), id);
-    } else if (id > root->getID()) {
-        root->m_right = removeHelper(root->getRight(), id);
+    unsigned int node = m_root;
+    if (m_nodes[node].m_left == 0) {
+        m_root = m_nodes[node].m_right;
     } else {
-        // Node to be removed found
-        if (root->m_left == nullptr) {
-            Robot* rightNode = root->m_right;
-            delete root;
-            return rightNode;
-        } else if (root->m_right == nullptr) {
-            Robot* leftNode = root->m_left;
-            delete root;
-            return leftNode;
+        m_root = splay(m_nodes[node].m_left, id);
+        m_nodes[m_root].m_right = m_nodes[node].m_right;
+    }
+    release(node);
+}
+
+// Relink every node into a perfectly balanced tree in O(n)
+void CompactSwarm::rebuildBalanced() {
+    unsigned int count = 0;
+    unsigned int list = treeToVine(m_root, count);
+    m_root = buildBalanced(list, count);
+}
+
+// Flatten a subtree into a sorted list linked through m_right
+unsigned int CompactSwarm::treeToVine(unsigned int root, unsigned int& count) {
+    unsigned int head = 0;
+    unsigned int tail = 0;
+    unsigned int node = root;
+    count = 0;
+
+    while (node != 0) {
+        unsigned int left = m_nodes[node].m_left;
+        if (left != 0) {
+            // Right rotation: the left child becomes the new top of the spine
+            m_nodes[node].m_left = m_nodes[left].m_right;
+            m_nodes[left].m_right = node;
+            node = left;
         } else {
-            // Two children case - Find the inorder successor
-            Robot* minLargerNode = getMinNode(root->m_right);
-            root->m_id = minLargerNode->getID();
-            root->m_right = removeHelper(root->m_right, minLargerNode->getID());
+            if (tail == 0) {
+                head = node;
+            } else {
+                m_nodes[tail].m_right = node;
+            }
+            tail = node;
+            node = m_nodes[node].m_right;
+            count++;
         }
     }
-    // Update height after deletion
-    root->m_height = 1 + max(getHeight(root->m_left), getHeight(root->m_right));
+    return head;
+}
 
-    // Balance the tree if it's an AVL tree
-    if (m_type == AVL) {
-        root = balanceTree(root);
+// Build a perfectly balanced tree out of the first count nodes of a sorted list
+unsigned int CompactSwarm::buildBalanced(unsigned int& list, unsigned int count) {
+    if (count == 0) {
+        return 0;
     }
 
+    unsigned int left = buildBalanced(list, count / 2);
+    unsigned int root = list;
+    list = m_nodes[list].m_right;
+
+    m_nodes[root].m_left = left;
+    m_nodes[root].m_right = buildBalanced(list, count - count / 2 - 1);
+    updateHeight(root);
     return root;
 }
 
-// Splay function - Moves the node with the given ID to the root
-Robot* Swarm::splay(Robot* root, int id) {
-    if (root == nullptr || root->getID() == id) {
-        return root;  // The root is already the node we want to splay
-    }
+// Dump function for in-order traversal, in the same format as Swarm::dumpTree
+void CompactSwarm::dumpTree() const {
+    NodeStack<unsigned int> stack;  // 0 marks where a closing parenthesis goes
+    unsigned int node = m_root;
 
-    // Left subtree case
-    if (id < root->getID()) {
-        if (root->m_left == nullptr) {
-            return root;  // Node not in the tree, return root
+    while (node != 0 || !stack.empty()) {
+        if (node != 0) {
+            cout << "(";
+            stack.push(node);
+            node = m_nodes[node].m_left;
+        } else {
+            unsigned int top = stack.pop();
+            if (top == 0) {
+                cout << ")";
+            } else {
+                cout << m_nodes[top].m_id << ":" << getHeight(top);
+                stack.push(0);
+                node = m_nodes[top].m_right;
+            }
         }
+    }
+    cout << endl;
+}
 
-        // Zig-Zig (Left Left) case
-        if (id < root->m_left->getID()) {
-            root->m_left->m_left = splay(root->m_left->m_left, id);
-            root = rightRotate(root);  // First rotation
-        }
-        // Zig-Zag (Left Right) case
-        else if (id > root->m_left->getID()) {
-            root->m_left->m_right = splay(root->m_left->m_right, id);
-            if (root->m_left->m_right != nullptr) {
-                root->m_left = leftRotate(root->m_left);  // Left rotation
+
+
+// ---------------------------------------------------------------------------
+// FrozenSwarm - Eytzinger layout snapshot
+// ---------------------------------------------------------------------------
+
+const int IDBLOCK = 16;          // IDs per 64-byte cache line
+const int BATCHSIZE = 8;         // Lookups interleaved by findBatch
+
+// Pack a robot's type and state into one byte
+static unsigned char packInfo(const Robot* robot) {
+    return static_cast<unsigned char>(robot->getType() | (robot->getState() << 3));
+}
+
+// Prefetch the line holding the descendants of slot k four levels down
+static inline void prefetchSlot(const int* ids, int k) {
+#if defined(__GNUC__)
+    __builtin_prefetch(ids + static_cast<long>(k) * IDBLOCK);
+#else
+    (void)ids;
+    (void)k;
+#endif
+}
+
+// Turn the final position of an Eytzinger descent into the lower bound slot
+// by cancelling the trailing right turns and the last left turn
+static inline int lowerBoundSlot(int k) {
+    while (k & 1) {
+        k >>= 1;
+    }
+    return k >> 1;
+}
+
+// Constructor - Empty snapshot
+FrozenSwarm::FrozenSwarm() : m_ids(nullptr), m_info(nullptr), m_size(0), m_levels(0),
+      m_mapping(nullptr), m_mappedLength(0) {
+    allocate(0);
+}
+
+// Constructor - Freeze a swarm. An in-order walk of the tree is paired with
+// an in-order walk of the implicit Eytzinger tree, filling slots in one pass.
+FrozenSwarm::FrozenSwarm(const Swarm& swarm) : m_ids(nullptr), m_info(nullptr), m_size(0), m_levels(0),
+      m_mapping(nullptr), m_mappedLength(0) {
+    allocate(swarm.size());
+
+    // Start at the leftmost slot of the implicit tree
+    int k = 1;
+    while (2 * k <= m_size) {
+        k *= 2;
+    }
+
+    RobotStack stack;
+    Robot* node = swarm.m_root;
+    while (node != nullptr || !stack.empty()) {
+        if (node != nullptr) {
+            stack.push(node);
+            node = node->m_left;
+        } else {
+            node = stack.pop();
+            if (node->m_deleted) {
+                node = node->m_right;  // Tombstones do not take a slot
+                continue;
+            }
+            m_ids[k] = node->getID();
+            m_info[k] = packInfo(node);
+            m_tally[node->getType()][node->getState()]++;
+            node = node->m_right;
+
+            // In-order successor of slot k
+            if (2 * k + 1 <= m_size) {
+                k = 2 * k + 1;
+                while (2 * k <= m_size) {
+                    k *= 2;
+                }
+            } else {
+                while (k & 1) {
+                    k >>= 1;
+                }
+                k >>= 1;
             }
         }
-        return (root->m_left == nullptr) ? root : rightRotate(root);  // Second rotation
     }
+}
+
+// Copy constructor
+FrozenSwarm::FrozenSwarm(const FrozenSwarm& rhs) : m_ids(nullptr), m_info(nullptr), m_size(0), m_levels(0),
+      m_mapping(nullptr), m_mappedLength(0) {
+    allocate(rhs.m_size);
+    memcpy(m_ids, rhs.m_ids, (m_size + 1) * sizeof(int));
+    memcpy(m_info, rhs.m_info, m_size + 1);
+    memcpy(m_tally, rhs.m_tally, sizeof(m_tally));
+}
+
+// Destructor
+FrozenSwarm::~FrozenSwarm() {
+    release();
+}
+
+// Assignment operator
+const FrozenSwarm& FrozenSwarm::operator=(const FrozenSwarm& rhs) {
+    if (this != &rhs) {
+        release();
+        allocate(rhs.m_size);
+        memcpy(m_ids, rhs.m_ids, (m_size + 1) * sizeof(int));
+        memcpy(m_info, rhs.m_info, m_size + 1);
+        memcpy(m_tally, rhs.m_tally, sizeof(m_tally));
+    }
+    return *this;
+}
+
+// Allocate storage for size robots, IDs on a cache line boundary
+void FrozenSwarm::allocate(int size) {
+    m_size = size;
+    m_levels = 0;
+    while ((1 << m_levels) <= size) {
+        m_levels++;
+    }
+    memset(m_tally, 0, sizeof(m_tally));
+
+    m_ids = static_cast<int*>(::operator new((size + 1) * sizeof(int), std::align_val_t(64)));
+    m_info = new unsigned char[size + 1];
+    m_ids[0] = 0;
+    m_info[0] = 0;
+}
+
+// Free storage, or unmap the file the arrays point into
+void FrozenSwarm::release() {
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mappedLength);
+        m_mapping = nullptr;
+        m_mappedLength = 0;
+    } else {
+        ::operator delete(m_ids, std::align_val_t(64));
+        delete[] m_info;
+    }
+    m_ids = nullptr;
+    m_info = nullptr;
+    m_size = 0;
+}
+
+// Lower bound - Branchless descent, each step moves to 2k or 2k+1
+int FrozenSwarm::lowerBound(int id) const {
+    int k = 1;
+    while (k <= m_size) {
+        prefetchSlot(m_ids, k);
+        k = 2 * k + (m_ids[k] < id);
+    }
+    return lowerBoundSlot(k);
+}
+
+// In-order successor - the leftmost slot of the right subtree, or the
+// nearest ancestor reached from a left child
+int FrozenSwarm::nextSlot(int slot) const {
+    if (2 * slot + 1 <= m_size) {
+        slot = 2 * slot + 1;
+        while (2 * slot <= m_size) {
+            slot *= 2;
+        }
+        return slot;
+    }
+    return lowerBoundSlot(slot);
+}
+
+// Find the slot holding this ID
+int FrozenSwarm::findSlot(int id) const {
+    int k = lowerBound(id);
+    return (k != 0 && m_ids[k] == id) ? k : 0;
+}
 
-    // Right subtree case
-    else {
-        if (root->m_right == nullptr) {
-            return root;  // Node not in the tree, return root
+// Find many IDs, interleaving BATCHSIZE descents level by level so their
+// cache misses overlap without explicit prefetching. The inner loop has no
+// branches on the data and is simple enough for the compiler to vectorize.
+void FrozenSwarm::findBatch(const int ids[], int count, int slots[]) const {
+    for (int first = 0; first < count; first += BATCHSIZE) {
+        int width = (count - first < BATCHSIZE) ? count - first : BATCHSIZE;
+        int k[BATCHSIZE];
+        for (int j = 0; j < width; j++) {
+            k[j] = 1;
         }
 
-        // Zag-Zig (Right Left) case
-        if (id < root->m_right->getID()) {
-            root->m_right->m_left = splay(root->m_right->m_left, id);
-            if (root->m_right->m_left != nullptr) {
-                root->m_right = rightRotate(root->m_right);  // Right rotation
+        for (int level = 0; level < m_levels; level++) {
+            for (int j = 0; j < width; j++) {
+                int inside = (k[j] <= m_size);
+                int slot = inside ? k[j] : 0;
+                k[j] = inside ? 2 * k[j] + (m_ids[slot] < ids[first + j]) : k[j];
             }
         }
-        // Zag-Zag (Right Right) case
-        else if (id > root->m_right->getID()) {
-            root->m_right->m_right = splay(root->m_right->m_right, id);
-            root = leftRotate(root);  // First left rotation
+
+        for (int j = 0; j < width; j++) {
+            int slot = lowerBoundSlot(k[j]);
+            slots[first + j] = (slot != 0 && m_ids[slot] == ids[first + j]) ? slot : 0;
         }
-        return (root->m_right == nullptr) ? root : leftRotate(root);  // Second rotation
     }
 }
 
-// Get the current tree type (BST, AVL, SPLAY, NONE)
-TREETYPE Swarm::getType() const {
-    return m_type;
+// Find function - Copy out the robot with this ID
+bool FrozenSwarm::find(int id, Robot& robot) const {
+    int slot = findSlot(id);
+    if (slot == 0) {
+        return false;
+    }
+    robot = Robot(id, getType(slot), getState(slot));
+    return true;
 }
 
-// Set tree type and rebuild the tree as AVL if necessary
-void Swarm::setType(TREETYPE type) {
-    if (m_type == type) {
-        return;  // No change in type
-    }
+// Contains function - Check whether a robot with this ID is in the snapshot
+bool FrozenSwarm::contains(int id) const {
+    return findSlot(id) != 0;
+}
 
-    if (type == NONE) {
-        clear();  // Clear the tree if changing to NONE
-    } 
-    else if (type == AVL && m_type != AVL) {
-        // Rebuild the tree as AVL
-        Robot* tempRoot = m_root; // Temporarily store the current root
-        m_root = nullptr; // Clear the current tree
-        
-        // Rebuild the tree recursively
-        rebuildAVL(tempRoot);  // Rebuild the tree in AVL mode
+// Mappable file layout (host byte order):
+//   0   "SWEY"           magic
+//   4   uint32           format version
+//   8   uint32           0x01020304, to detect a foreign byte order
+//   12  uint32           robot count n
+//   16  uint32[5][2]     type/state tallies
+//   56  8 bytes          reserved, zero
+//   64  int32[n + 1]     IDs in Eytzinger order, slot 0 unused
+//   .   uint8[n + 1]     type | state << 3 per slot
+// The IDs start on a cache line, as in memory, so the mapped searches run
+// the same code and prefetch pattern.
+static const unsigned char MAPMAGIC[4] = {'S', 'W', 'E', 'Y'};
+static const unsigned int MAPVERSION = 1;
+static const unsigned int MAPORDER = 0x01020304;
+static const int MAPHEADER = 64;
+
+// Expected length of a mappable file of size robots, or 0 for a count too
+// large to index with an int or whose length would overflow a size_t
+static size_t mappedLength(unsigned int size) {
+    size_t slots = static_cast<size_t>(size) + 1;
+    if (size >= static_cast<unsigned int>(INT_MAX)
+        || slots > (static_cast<size_t>(-1) - MAPHEADER) / (sizeof(int) + 1)) {
+        return 0;
     }
+    return MAPHEADER + slots * (sizeof(int) + 1);
+}
 
-    // Set the new tree type
-    m_type = type;
+// Save function - Write the header and both arrays with three calls
+bool FrozenSwarm::save(const string& path) const {
+    unsigned int header[MAPHEADER / sizeof(unsigned int)] = {};
+    memcpy(header, MAPMAGIC, 4);
+    header[1] = MAPVERSION;
+    header[2] = MAPORDER;
+    header[3] = static_cast<unsigned int>(m_size);
+    memcpy(&header[4], m_tally, sizeof(m_tally));
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(header, 1, MAPHEADER, file) == static_cast<size_t>(MAPHEADER)
+                   && fwrite(m_ids, sizeof(int), m_size + 1, file) == static_cast<size_t>(m_size + 1)
+                   && fwrite(m_info, 1, m_size + 1, file) == static_cast<size_t>(m_size + 1);
+    return (fclose(file) == 0) && written;
 }
 
-// Helper to rebuild the tree as AVL recursively
-void Swarm::rebuildAVL(Robot* node) {
-    if (node == nullptr) {
-        return;
+// Map function - Check the header and the file length, then point the
+// arrays into a read-only private mapping. Slot contents are not checked,
+// since that would touch every page. On failure the snapshot is unchanged.
+bool FrozenSwarm::map(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    off_t length = lseek(fd, 0, SEEK_END);
+    void* mapping = (length >= MAPHEADER)
+                    ? mmap(nullptr, static_cast<size_t>(length), PROT_READ, MAP_PRIVATE, fd, 0)
+                    : MAP_FAILED;
+    ::close(fd);  // The mapping stays valid without the descriptor
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const unsigned int* header = static_cast<const unsigned int*>(mapping);
+    unsigned int size = header[3];
+    if (memcmp(header, MAPMAGIC, 4) != 0 || header[1] != MAPVERSION || header[2] != MAPORDER
+        || mappedLength(size) != static_cast<size_t>(length)) {
+        munmap(mapping, static_cast<size_t>(length));
+        return false;
     }
 
-    // Recursively rebuild the left subtree
-    rebuildAVL(node->m_left);
+    release();
+    m_mapping = mapping;
+    m_mappedLength = static_cast<size_t>(length);
+    m_size = static_cast<int>(size);
+    m_levels = 0;
+    while ((1 << m_levels) <= m_size) {
+        m_levels++;
+    }
+    memcpy(m_tally, &header[4], sizeof(m_tally));
+    m_ids = reinterpret_cast<int*>(static_cast<char*>(mapping) + MAPHEADER);
+    m_info = reinterpret_cast<unsigned char*>(m_ids + m_size + 1);
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// ConcurrentSwarm - single writer, lock-free readers
+// ---------------------------------------------------------------------------
 
-    // Insert the current node into the new AVL tree
-    Robot tempRobot(node->getID(), node->getType(), node->getState());
-    m_type = AVL; // Ensure we are using AVL logic for balancing here
-    insert(tempRobot);
+// Read guard - Pin the current version
+ConcurrentSwarm::ReadGuard::ReadGuard(const ConcurrentSwarm& swarm)
+    : m_swarm(swarm), m_slot(swarm.pin()) {
+    m_version = &swarm.m_current.load()->m_frozen;
+}
 
-    // Recursively rebuild the right subtree
-    rebuildAVL(node->m_right);
+// Read guard - Release the pin
+ConcurrentSwarm::ReadGuard::~ReadGuard() {
+    m_swarm.unpin(m_slot);
 }
 
-// Helper function to find the minimum node (leftmost node)
-Robot* Swarm::getMinNode(Robot* root) const {
-    while (root->m_left != nullptr) {
-        root = root->m_left;
+// Constructor - Default tree type is NONE
+ConcurrentSwarm::ConcurrentSwarm() : ConcurrentSwarm(NONE) {}
+
+// Constructor - Start with an empty published version so readers never see nullptr
+ConcurrentSwarm::ConcurrentSwarm(TREETYPE type)
+    : m_writer(type), m_current(nullptr), m_epoch(1), m_retired(nullptr) {
+    for (int i = 0; i < READERSLOTS; i++) {
+        m_slots[i].m_epoch.store(0);
+        m_slots[i].m_claimed.store(false);
     }
-    return root;
+    m_current.store(new Version(m_writer));
 }
 
-// Clone function for deep copy (recursive)
-Robot* Swarm::clone(Robot* root) const {
-    if (root == nullptr) {
-        return nullptr;
+// Destructor - Free the current and every retired version
+ConcurrentSwarm::~ConcurrentSwarm() {
+    delete m_current.load();
+    while (m_retired != nullptr) {
+        Version* next = m_retired->m_next;
+        delete m_retired;
+        m_retired = next;
     }
+}
 
-    Robot* newRoot = new Robot(root->getID(), root->getType(), root->getState());
-    newRoot->m_left = clone(root->m_left);
-    newRoot->m_right = clone(root->m_right);
-    newRoot->m_height = root->m_height;
-    return newRoot;
+// Writer operations - Edit the private tree only
+void ConcurrentSwarm::insert(const Robot& robot) {
+    m_writer.insert(robot);
 }
 
-// Assignment operator for Swarm class
-const Swarm& Swarm::operator=(const Swarm& rhs) {
-    // Check for self-assignment
-    if (this != &rhs) {
-        // Clear the existing tree
-        clear();
+void ConcurrentSwarm::remove(int id) {
+    m_writer.remove(id);
+}
 
-        // Deep copy the tree from the rhs (right-hand side)
-        m_type = rhs.m_type;
-        m_root = clone(rhs.m_root);  // Recursively clone the tree
-    }
-    return *this;  // Return the current object
+bool ConcurrentSwarm::setState(int id, STATE state) {
+    return m_writer.setState(id, state);
 }
 
-// Balance the AVL tree if necessary
-Robot* Swarm::balanceTree(Robot* node) {
-    if (node == nullptr) return node;
+bool ConcurrentSwarm::setRobotType(int id, ROBOTTYPE type) {
+    return m_writer.setRobotType(id, type);
+}
 
-    int balanceFactor = getBalance(node);
+void ConcurrentSwarm::bulkLoad(const Robot robots[], int count) {
+    m_writer.bulkLoad(robots, count);
+}
 
-    // Left heavy case
-    if (balanceFactor > 1) {
-        if (getBalance(node->m_left) < 0) {
-            node->m_left = leftRotate(node->m_left);  // Left-right case
+// Publish function - Freeze the writer's tree and swap it in for new readers.
+// The replaced version is tagged with the epoch it was retired in; a reader
+// pinned at that epoch or earlier may still hold it.
+void ConcurrentSwarm::publish() {
+    Version* old = m_current.exchange(new Version(m_writer));
+    old->m_retired = m_epoch.fetch_add(1);
+    old->m_next = m_retired;
+    m_retired = old;
+    reclaim();
+}
+
+// Reader operations - One pinned lookup each
+bool ConcurrentSwarm::find(int id, Robot& robot) const {
+    ReadGuard guard(*this);
+    return guard->find(id, robot);
+}
+
+bool ConcurrentSwarm::contains(int id) const {
+    ReadGuard guard(*this);
+    return guard->contains(id);
+}
+
+int ConcurrentSwarm::size() const {
+    ReadGuard guard(*this);
+    return guard->size();
+}
+
+// Claim a free reader slot, starting where this thread last found one, and
+// announce the current epoch before the version pointer is read. When every
+// slot is taken the thread yields after each full sweep, so waiting readers
+// do not starve the ones holding slots.
+int ConcurrentSwarm::pin() const {
+    static thread_local int hint = 0;
+    for (int slot = hint, tried = 0; ; slot = (slot + 1) % READERSLOTS) {
+        bool expected = false;
+        if (!m_slots[slot].m_claimed.load(std::memory_order_relaxed)
+            && m_slots[slot].m_claimed.compare_exchange_strong(expected, true)) {
+            m_slots[slot].m_epoch.store(m_epoch.load());
+            hint = slot;
+            return slot;
+        }
+        if (++tried == READERSLOTS) {
+            tried = 0;
+            std::this_thread::yield();
         }
-        return rightRotate(node);  // Left-left case
     }
+}
 
-    // Right heavy case
-    if (balanceFactor < -1) {
-        if (getBalance(node->m_right) > 0) {
-            node->m_right = rightRotate(node->m_right);  // Right-left case
+// Leave a reader slot idle and free for other readers
+void ConcurrentSwarm::unpin(int slot) const {
+    m_slots[slot].m_epoch.store(0);
+    m_slots[slot].m_claimed.store(false, std::memory_order_release);
+}
+
+// Free the retired versions that were replaced before the oldest pinned
+// reader announced its epoch. Readers that announced later loaded a newer
+// version, so nothing they hold is freed.
+void ConcurrentSwarm::reclaim() {
+    unsigned long long oldest = ULLONG_MAX;
+    for (int i = 0; i < READERSLOTS; i++) {
+        unsigned long long epoch = m_slots[i].m_epoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
         }
-        return leftRotate(node);  // Right-right case
     }
 
-    return node;
+    Version** link = &m_retired;
+    while (*link != nullptr) {
+        Version* version = *link;
+        if (version->m_retired < oldest) {
+            *link = version->m_next;
+            delete version;
+        } else {
+            link = &version->m_next;
+        }
+    }
 }
 
-// Left rotation helper function
-Robot* Swarm::leftRotate(Robot* x) {
-    Robot* y = x->m_right;
-    Robot* T2 = y->m_left;
 
-    y->m_left = x;
-    x->m_right = T2;
+// ---------------------------------------------------------------------------
+// ShardedSwarm - one lock per contiguous ID range
+// ---------------------------------------------------------------------------
 
-    // Update heights
-    x->m_height = 1 + max(getHeight(x->m_left), getHeight(x->m_right));
-    y->m_height = 1 + max(getHeight(y->m_left), getHeight(y->m_right));
+// Constructor - Default tree type is NONE
+ShardedSwarm::ShardedSwarm() : ShardedSwarm(NONE) {}
 
-    return y;
+// Constructor - Between 1 and IDCOUNT shards of equal ID width
+ShardedSwarm::ShardedSwarm(TREETYPE type, int shards)
+    : m_shards(nullptr), m_shardCount(min(max(shards, 1), IDCOUNT)) {
+    m_shards = new Shard*[m_shardCount];
+    for (int i = 0; i < m_shardCount; i++) {
+        m_shards[i] = new Shard(type);
+    }
 }
 
-// Right rotation helper function
-Robot* Swarm::rightRotate(Robot* y) {
-    Robot* x = y->m_left;
-    Robot* T2 = x->m_right;
+// Destructor - No other thread may still use the swarm
+ShardedSwarm::~ShardedSwarm() {
+    for (int i = 0; i < m_shardCount; i++) {
+        delete m_shards[i];
+    }
+    delete[] m_shards;
+}
 
-    x->m_right = y;
-    y->m_left = T2;
+// Shard function - IDs outside MINID..MAXID go to the end shards
+int ShardedSwarm::shardOf(int id) const {
+    if (id <= MINID) {
+        return 0;
+    }
+    if (id >= MAXID) {
+        return m_shardCount - 1;
+    }
+    return static_cast<int>(static_cast<long long>(id - MINID) * m_shardCount / IDCOUNT);
+}
 
-    // Update heights
-    y->m_height = 1 + max(getHeight(y->m_left), getHeight(y->m_right));
-    x->m_height = 1 + max(getHeight(x->m_left), getHeight(x->m_right));
+// Point operations - Lock the owning shard for the call
+void ShardedSwarm::insert(const Robot& robot) {
+    Shard& shard = *m_shards[shardOf(robot.getID())];
+    lock_guard<mutex> lock(shard.m_lock);
+    shard.m_swarm.insert(robot);
+}
 
-    return x;
+void ShardedSwarm::remove(int id) {
+    Shard& shard = *m_shards[shardOf(id)];
+    lock_guard<mutex> lock(shard.m_lock);
+    shard.m_swarm.remove(id);
 }
 
-// Get height of a node
-int Swarm::getHeight(Robot* node) const {
-    return (node == nullptr) ? -1 : node->getHeight();
+bool ShardedSwarm::find(int id, Robot& robot) {
+    Shard& shard = *m_shards[shardOf(id)];
+    lock_guard<mutex> lock(shard.m_lock);
+    const Robot* node = shard.m_swarm.find(id);
+    if (node == nullptr) {
+        return false;
+    }
+    robot = Robot(node->getID(), node->getType(), node->getState());
+    return true;
 }
 
-// Get balance factor of a node
-int Swarm::getBalance(Robot* node) const {
-    return (node == nullptr) ? 0 : getHeight(node->m_left) - getHeight(node->m_right);
+bool ShardedSwarm::contains(int id) {
+    Shard& shard = *m_shards[shardOf(id)];
+    lock_guard<mutex> lock(shard.m_lock);
+    return shard.m_swarm.contains(id);
 }
 
-// Dump function for in-order traversal
-void Swarm::dumpTree() const {
-    dump(m_root);
-    cout << endl;
+bool ShardedSwarm::setState(int id, STATE state) {
+    Shard& shard = *m_shards[shardOf(id)];
+    lock_guard<mutex> lock(shard.m_lock);
+    return shard.m_swarm.setState(id, state);
+}
+
+bool ShardedSwarm::setRobotType(int id, ROBOTTYPE type) {
+    Shard& shard = *m_shards[shardOf(id)];
+    lock_guard<mutex> lock(shard.m_lock);
+    return shard.m_swarm.setRobotType(id, type);
+}
+
+// Size function - Each shard is read under its lock, so the total is exact
+// only while no writer is running
+int ShardedSwarm::size() const {
+    int total = 0;
+    for (int i = 0; i < m_shardCount; i++) {
+        lock_guard<mutex> lock(m_shards[i]->m_lock);
+        total += m_shards[i]->m_swarm.size();
+    }
+    return total;
+}
+
+// ID of a batch entry
+static int batchID(const Robot& robot) {
+    return robot.getID();
+}
+
+static int batchID(int id) {
+    return id;
 }
 
-void Swarm::dump(Robot* aBot) const {
-    if (aBot != nullptr) {
-        cout << "(";
-        dump(aBot->m_left);  // Visit left child
-        cout << aBot->m_id << ":" << aBot->m_height;  // Visit node itself
-        dump(aBot->m_right);  // Visit right child
-        cout << ")";
+// Group a batch by shard with a stable counting sort, then run
+// apply(swarm, group, groupCount) under each shard's lock. Groups are dealt
+// round-robin to at most one task per pool thread; small batches stay on
+// the calling thread.
+template <class Item, class Apply>
+static void dispatchByShard(const ShardedSwarm& sharded, const Item items[], int count,
+                            Apply apply) {
+    int shards = sharded.shardCount();
+    vector<int> start(shards + 1, 0);
+    for (int i = 0; i < count; i++) {
+        start[sharded.shardOf(batchID(items[i])) + 1]++;
     }
-}
\ No newline at end of file
+    vector<int> busy;
+    for (int s = 0; s < shards; s++) {
+        if (start[s + 1] > 0) {
+            busy.push_back(s);
+        }
+        start[s + 1] += start[s];
+    }
+    vector<Item> grouped(items, items + count);
+    vector<int> next(start.begin(), start.end() - 1);
+    for (int i = 0; i < count; i++) {
+        grouped[next[sharded.shardOf(batchID(items[i]))]++] = items[i];
+    }
+
+    TaskPool& pool = TaskPool::instance();
+    int tasks = (count < PARALLELCUTOFF) ? 1 : min(pool.workers() + 1, static_cast<int>(busy.size()));
+    vector<function<void()>> work(tasks);
+    for (int t = 0; t < tasks; t++) {
+        work[t] = [t, tasks, &busy, &start, &grouped, &apply]() {
+            for (size_t j = t; j < busy.size(); j += tasks) {
+                int s = busy[j];
+                apply(s, &grouped[start[s]], start[s + 1] - start[s]);
+            }
+        };
+    }
+    if (tasks > 0) {
+        pool.run(work.data(), tasks);
+    }
+}
+
+// Insert a batch - A group at least as large as its shard is merged with
+// one O(n) bulk load, smaller groups are inserted one by one
+void ShardedSwarm::insertBatch(const Robot robots[], int count) {
+    dispatchByShard(*this, robots, count, [this](int s, const Robot* group, int groupCount) {
+        lock_guard<mutex> lock(m_shards[s]->m_lock);
+        Swarm& swarm = m_shards[s]->m_swarm;
+        if (groupCount >= swarm.size()) {
+            swarm.bulkLoad(group, groupCount);
+        } else {
+            for (int i = 0; i < groupCount; i++) {
+                swarm.insert(group[i]);
+            }
+        }
+    });
+}
+
+// Remove a batch - One lock per shard group
+void ShardedSwarm::removeBatch(const int ids[], int count) {
+    dispatchByShard(*this, ids, count, [this](int s, const int* group, int groupCount) {
+        lock_guard<mutex> lock(m_shards[s]->m_lock);
+        for (int i = 0; i < groupCount; i++) {
+            m_shards[s]->m_swarm.remove(group[i]);
+        }
+    });
+}
@@ -1,24 +1,49 @@
 #ifndef SWARM_H
 #define SWARM_H
 
+#include <atomic>
+#include <climits>
 #include <iostream>
+#include <mutex>
 using namespace std;
 
 class Grader;  // This class is for grading purposes, no need to do anything
 class Tester;  // This is your tester class, you add your test functions in this class
 
 class Swarm;
+class SwarmIterator;
+class FrozenSwarm;
+class SwarmJournal;
+class ExportBuffer;
 
 // Enum declarations
 enum STATE {ALIVE, DEAD};   // Possible states for a robot
 enum ROBOTTYPE {BIRD, DRONE, REPTILE, SUB, QUADRUPED};
 enum TREETYPE {NONE, BST, AVL, SPLAY};
+enum OPKIND {OPINSERT, OPREMOVE, OPUPDATE};   // Batched operations
+enum OPRESULT {APPLIED, ALREADYPRESENT, NOTFOUND};   // Outcome of a batched operation
+enum EXPORTFORMAT {EXPORTTREE, EXPORTIDS, EXPORTJSON, EXPORTCSV};   // Swarm::exportTo formats
 
 // Constants
 const int MINID = 10000;    // Min robot ID
 const int MAXID = 99999;    // Max robot ID
+const int IDCOUNT = MAXID - MINID + 1;  // Number of valid robot IDs
+const int SLABSIZE = 512;   // Robot nodes carved out of each allocator slab
+const int STACKSIZE = 64;   // Traversal stack entries kept inline before spilling to the heap
+const int TYPECOUNT = 5;    // Number of ROBOTTYPE values
+const int STATECOUNT = 2;   // Number of STATE values
+const int REFSTICKY = 0xFFFF;  // Saturated node reference count, the node is never freed
+const int PARALLELCUTOFF = 4096;  // Work size below which set operations and batches stay on one thread
+const int READERSLOTS = 64; // Concurrent ReadGuards a ConcurrentSwarm can hold at once
+const int SHARDCOUNT = 16;  // Default number of ID range shards in a ShardedSwarm
+const int BATCHREBUILD = 2;   // Batches of at least size()/BATCHREBUILD ops are merged into a rebuilt tree
+const int JOURNALBATCH = 4096;   // Journal records that trigger a group commit early
+const int JOURNALINTERVAL = 5;   // Milliseconds a journal record may wait for its group commit
+const int EXPORTBUFFER = 1 << 16;  // Bytes gathered by Swarm::exportTo before each write
 
 #define DEFAULT_HEIGHT 0
+#define DEFAULT_SIZE 1
+#define DEFAULT_REFS 1
 #define DEFAULT_ID 0
 #define DEFAULT_TYPE DRONE
 #define DEFAULT_STATE ALIVE
@@ -27,23 +52,33 @@ const int MAXID = 99999;    // Max robot ID
 class Robot {
 public:
     friend class Swarm;
+    friend class RobotPool;
+    friend class RobotIndex;
+    friend class FrozenSwarm;
+    friend class SwarmIterator;
     friend class Grader;
     friend class Tester;
 
     Robot(int id, ROBOTTYPE type = DEFAULT_TYPE, STATE state = DEFAULT_STATE)
         : m_id(id), m_type(type), m_state(state) {
+            m_deleted = false;
+            m_refs = DEFAULT_REFS;
             m_left = nullptr;
             m_right = nullptr;
             m_height = DEFAULT_HEIGHT;
+            m_size = DEFAULT_SIZE;
         }
 
     Robot() {
         m_id = DEFAULT_ID;
         m_type = DEFAULT_TYPE;
         m_state = DEFAULT_STATE;
+        m_deleted = false;
+        m_refs = DEFAULT_REFS;
         m_left = nullptr;
         m_right = nullptr;
         m_height = DEFAULT_HEIGHT;
+        m_size = DEFAULT_SIZE;
     }
 
     int getID() const { return m_id; }
@@ -73,6 +108,7 @@ public:
     }
     
     int getHeight() const { return m_height; }
+    int getSize() const { return m_size; }
     Robot* getLeft() const { return m_left; }
     Robot* getRight() const { return m_right; }
 
@@ -87,63 +123,732 @@ private:
     int m_id;           // Unique ID for the robot
     ROBOTTYPE m_type;   // Type of robot
     STATE m_state;      // State of the robot (alive/dead)
+    bool m_deleted;     // Tombstoned by a lazy remove, unlinked by Swarm::compact()
+    unsigned short m_refs;  // Links (parents and roots) to this node across snapshots
     Robot* m_left;      // Pointer to the left child in the BST
     Robot* m_right;     // Pointer to the right child in the BST
     int m_height;       // Height of the node (for AVL balancing)
+    int m_size;         // Number of live (not tombstoned) robots in the subtree rooted here
+};
+
+// RobotPool class definition
+// Slab allocator for the Robot nodes of one Swarm. Nodes are carved out of
+// SLABSIZE-node slabs so neighbours in allocation order sit next to each other
+// in memory, and released nodes are recycled through an intrusive free list
+// threaded through m_right.
+class RobotPool {
+public:
+    friend class Grader;
+    friend class Tester;
+
+    RobotPool();
+    ~RobotPool();  // Destructor - frees every slab
+
+    Robot* allocate(const Robot& robot);   // Take a node off the free list and copy robot into it
+    Robot* allocate(int id, ROBOTTYPE type, STATE state);  // Construct a robot directly in a free node
+    void adopt(RobotPool& other);          // Take over other's slabs, other is left empty
+    void release(Robot* node);             // Return a single node to the free list
+    void releaseAll();                     // Drop every slab, O(number of slabs)
+
+    // Swarms sharing the pool through snapshots
+    void addUser();
+    int dropUser();                        // Returns the number of users left
+    int users() const { return m_users; }
+
+private:
+    struct Slab {
+        Slab* m_next;                      // Next slab owned by the pool
+        Robot m_nodes[SLABSIZE];           // Node storage
+    };
+
+    Slab* m_slabs;      // Singly linked list of slabs
+    Robot* m_freeList;  // Free nodes, linked through m_right
+    int m_users;        // Swarms allocating from and freeing into this pool
+
+    void grow();        // Allocate a new slab and thread its nodes onto the free list
+
+    // The pool owns raw storage, copying it would double free
+    RobotPool(const RobotPool&) = delete;
+    RobotPool& operator=(const RobotPool&) = delete;
+};
+
+// NodeStack class definition
+// Stack for the iterative tree walks, holding node pointers (RobotStack) or
+// node indices (CompactSwarm). The first STACKSIZE entries live inside the
+// object, so walks over balanced trees never touch the heap; a degenerate
+// BST spills into a heap buffer that doubles as needed.
+template <class T>
+class NodeStack {
+public:
+    NodeStack() : m_data(m_local), m_size(0), m_capacity(STACKSIZE) {}
+    NodeStack(const NodeStack& rhs) : m_data(m_local), m_size(0), m_capacity(STACKSIZE) {
+        *this = rhs;
+    }
+    ~NodeStack() {
+        if (m_data != m_local) {
+            delete[] m_data;
+        }
+    }
+
+    // Copy the entries into this stack's own storage; m_data may point into
+    // rhs itself, so the buffer is never shared
+    NodeStack& operator=(const NodeStack& rhs) {
+        if (this != &rhs) {
+            m_size = 0;
+            while (m_capacity < rhs.m_size) {
+                grow();
+            }
+            for (int i = 0; i < rhs.m_size; i++) {
+                m_data[i] = rhs.m_data[i];
+            }
+            m_size = rhs.m_size;
+        }
+        return *this;
+    }
+
+    void push(T node) {
+        if (m_size == m_capacity) {
+            grow();
+        }
+        m_data[m_size++] = node;
+    }
+    T pop() { return m_data[--m_size]; }
+    T top() const { return m_data[m_size - 1]; }
+    void set(int index, T node) { m_data[index] = node; }
+    bool empty() const { return m_size == 0; }
+    int size() const { return m_size; }
+    void clear() { m_size = 0; }
+
+private:
+    T m_local[STACKSIZE];   // Inline storage
+    T* m_data;              // m_local, or a heap buffer after growing
+    int m_size;             // Number of entries on the stack
+    int m_capacity;         // Capacity of m_data
+
+    // Move the stack into a heap buffer twice the size
+    void grow() {
+        T* data = new T[m_capacity * 2];
+        for (int i = 0; i < m_size; i++) {
+            data[i] = m_data[i];
+        }
+        if (m_data != m_local) {
+            delete[] m_data;
+        }
+        m_data = data;
+        m_capacity *= 2;
+    }
+};
+
+typedef NodeStack<Robot*> RobotStack;
+
+// RobotIndex class definition
+// Dense side index over the MINID..MAXID universe: a presence bitmap that
+// answers membership in one small cache-resident lookup, and a node pointer
+// array for direct access. IDs outside the range are not covered.
+class RobotIndex {
+public:
+    friend class Grader;
+    friend class Tester;
+
+    RobotIndex();
+
+    static bool covers(int id) { return id >= MINID && id <= MAXID; }
+    bool test(int id) const {
+        return (m_present[(id - MINID) >> 5] >> ((id - MINID) & 31)) & 1;
+    }
+    Robot* get(int id) const { return m_nodes[id - MINID]; }  // nullptr when absent
+
+    void set(Robot* node);   // Record node under its ID, if covered
+    void erase(int id);      // Forget an ID, if covered
+    void clear();            // Forget every ID
+
+private:
+    unsigned int m_present[(IDCOUNT + 31) / 32];  // One bit per ID
+    Robot* m_nodes[IDCOUNT];                      // Node for each present ID
+};
+
+// SwarmIterator class definition
+// In-order iterator over a Swarm. The pending ancestors live in a
+// RobotStack, so iterating a balanced tree never allocates and a degenerate
+// BST or splay tree spills to the heap instead of being searched again.
+// Iterators never splay, and any change to the swarm invalidates them.
+class SwarmIterator {
+public:
+    friend class Swarm;
+    friend class Grader;
+    friend class Tester;
+
+    SwarmIterator();  // End iterator
+
+    const Robot& operator*() const { return *m_node; }
+    const Robot* operator->() const { return m_node; }
+    SwarmIterator& operator++();
+    bool operator==(const SwarmIterator& rhs) const { return m_node == rhs.m_node; }
+    bool operator!=(const SwarmIterator& rhs) const { return m_node != rhs.m_node; }
+
+private:
+    Robot* m_root;                // Root of the tree being iterated
+    Robot* m_node;                // Current robot, nullptr at the end
+    RobotStack m_stack;           // Ancestors whose left subtree holds m_node
+
+    SwarmIterator(Robot* root, int id);  // Position at the first robot with ID >= id
+    void step();                         // Move to the next node, tombstoned or not
+    void seek(int id);                   // Descend from the root to the first ID >= id
+};
+
+// SwarmOp struct definition
+// One operation of a batch for Swarm::applyBatch. An update sets both the
+// type and the state of an existing robot. m_result is filled in when the
+// batch is applied.
+struct SwarmOp {
+    SwarmOp(OPKIND kind, int id, ROBOTTYPE type = DEFAULT_TYPE, STATE state = DEFAULT_STATE)
+        : m_kind(kind), m_id(id), m_type(type), m_state(state), m_result(APPLIED) {}
+
+    OPKIND m_kind;
+    int m_id;
+    ROBOTTYPE m_type;
+    STATE m_state;
+    OPRESULT m_result;
 };
 
 // Swarm class definition
 class Swarm {
 public:
+    friend class FrozenSwarm;
     friend class Grader;
     friend class Tester;
 
     // Constructors, Destructor
     Swarm();
     Swarm(TREETYPE type);
+    Swarm(const Swarm& rhs);       // Deep copy
+    Swarm(Swarm&& rhs) noexcept;   // O(1), rhs is left empty
     ~Swarm();  // Destructor
 
-    // Overloaded assignment operator
+    // Overloaded assignment operators
     const Swarm& operator=(const Swarm& rhs);
+    const Swarm& operator=(Swarm&& rhs) noexcept;   // O(1), rhs is left empty; both keep their journals
+    void swap(Swarm& other) noexcept;              // Journals are swapped along with the robots
 
     // Basic tree operations
     void insert(const Robot& robot);
-    void remove(int id);
+    void insert(Robot&& robot);
+    void emplace(int id, ROBOTTYPE type = DEFAULT_TYPE, STATE state = DEFAULT_STATE);
+    void remove(int id);               // Tombstones the robot instead in lazy-delete mode
     void clear();
     TREETYPE getType() const;
     void setType(TREETYPE type);
 
+    // Point lookup - splays the accessed node to the root in SPLAY mode
+    const Robot* find(int id);       // Robot with this ID, or nullptr
+    bool contains(int id);
+
+    // In-place updates - no structural change, never splay. False if the ID is absent.
+    bool setState(int id, STATE state);
+    bool setRobotType(int id, ROBOTTYPE type);
+
+    // Lazy deletion - remove() only marks the robot as deleted, which is an
+    // O(log n) write with no relinking or rebalancing. Tombstoned robots are
+    // invisible to every query and are unlinked by compact() in one O(n) pass.
+    void setLazyDelete(bool lazy);
+    bool isLazyDelete() const;
+    void compact();
+
+    // Dense ID index - O(1) find/contains and duplicate checks for MINID..MAXID.
+    // Lookups answered by the index do not splay.
+    void setIndexed(bool indexed);
+    bool isIndexed() const;
+
+    // Order statistics - O(log n) using subtree sizes, never splay
+    int size() const;                         // Number of robots in the swarm
+    int rank(int id) const;                   // Number of robots with an ID below id
+    const Robot* select(int k) const;         // Robot at 0-based position k in ID order
+    int countInRange(int lo, int hi) const;   // Number of robots with lo <= ID <= hi
+
+    // Type/state tallies - kept up to date by every insertion and removal
+    int count(ROBOTTYPE type, STATE state) const;   // O(1)
+    int countInRange(int lo, int hi, ROBOTTYPE type, STATE state) const;   // O(log n + k)
+
+    // Ordered iteration - O(log n) to position, O(1) amortized per step
+    SwarmIterator begin() const;
+    SwarmIterator end() const;
+    SwarmIterator lowerBound(int id) const;   // First robot with ID >= id
+
+    // Call visit(robot) for every robot with lo <= ID <= hi, in ID order
+    template <class Visitor>
+    void forEachInRange(int lo, int hi, Visitor visit) const;
+
+    // Bulk loading - merge a batch (sorted or not) and rebuild a balanced tree
+    void bulkLoad(const Robot robots[], int count);
+
+    // Batched operations - operations on the same ID take effect in batch
+    // order. Sets each op's m_result. A smaller batch costs one search per
+    // op; one of at least size()/BATCHREBUILD ops is merged with the tree in
+    // one pass and the tree is rebuilt balanced, O(n + m log m), dropping
+    // any tombstones.
+    void applyBatch(SwarmOp ops[], int count);
+
+    // Persistent snapshot - O(1). The snapshot shares every node with this
+    // swarm; later inserts and removals on either side copy only the nodes on
+    // their search path (path copying), so a snapshot costs memory in
+    // proportion to what changed after it. Whole-tree operations (setType,
+    // bulkLoad, compact) and SPLAY mode accesses first take a private O(n) copy.
+    // Snapshots that share nodes must be used from one thread.
+    Swarm snapshot();
+
+    // Split/join - O(log n) for BST and AVL swarms (amortized for SPLAY).
+    // split(id) moves every robot with an ID >= id into the returned swarm,
+    // which shares this swarm's pool. join(other) moves all of other's robots
+    // into this swarm and leaves other empty; if the two ID ranges overlap it
+    // falls back to unionWith. Moved robots are (un)registered in the dense
+    // index one by one, and type/state tallies are recounted on next use.
+    // Swarms that share a pool must be used from one thread; to hand a half
+    // to another thread, copy it (the copy gets its own pool) in O(k).
+    Swarm split(int id);
+    void join(Swarm& other);
+
+    // Set operations with another swarm, which is left unchanged. Work is
+    // O(m log(n/m + 1)) for m = other.size(), split by ID range into
+    // independent pieces that run in parallel. Duplicate IDs keep this
+    // swarm's robot.
+    void unionWith(const Swarm& other);
+    void intersectWith(const Swarm& other);
+    void difference(const Swarm& other);     // Remove every ID found in other
+    static void setThreads(int threads);     // Threads for set operations, including the caller
+
+    // Immutable read-only copy laid out for fast searching
+    FrozenSwarm freeze() const;
+
+    // Binary checkpoints - a header, the IDs in ascending order, one packed
+    // type/state byte per robot and a checksum, all little-endian. load()
+    // reads the file in one call, checks it and rebuilds a balanced tree in
+    // O(n), restoring the saved tree type. Any ID the swarm holds is saved,
+    // in or out of MINID..MAXID. Both return false on an I/O or format
+    // error, and load() then leaves the swarm unchanged.
+    bool save(const string& path) const;
+    bool load(const string& path);
+
+    // Write-ahead journal - every insert, remove, setState, setRobotType,
+    // clear, bulkLoad and applyBatch appends an 8-byte record to a buffer.
+    // A background thread writes the buffer out as one checksummed block and
+    // fsyncs it at least every JOURNALINTERVAL ms (a group commit), so a
+    // crash loses at most the last group. split and join log one record per
+    // robot moved; load, assignment and the set operations log a clear and
+    // then every robot, so take a checkpoint() after them to keep the
+    // journal short.
+    bool openJournal(const string& path);    // Continue an existing journal, dropping a torn tail
+    void closeJournal();                     // Flush and stop journaling
+    bool syncJournal();                      // Wait until every record so far is on disk
+    bool checkpoint(const string& path);     // Save atomically, then empty the journal
+    // Load the checkpoint (an empty swarm if there is none) and replay the
+    // journal's intact blocks through applyBatch
+    bool recover(const string& checkpointPath, const string& journalPath);
+
     // Tree printing (in-order traversal)
     void dumpTree() const;
 
+    // Export - one EXPORTBUFFER-byte buffer, integers formatted by hand and
+    // an iterative traversal. EXPORTTREE is dumpTree()'s parenthesized text,
+    // EXPORTIDS the live IDs in order one per line, EXPORTJSON an object with
+    // a robots array and EXPORTCSV an id,type,state table. Every format ends
+    // with a newline. Returns false if the stream or descriptor fails.
+    bool exportTo(ostream& out, EXPORTFORMAT format) const;
+    bool exportTo(int fd, EXPORTFORMAT format) const;
+
 private:
     Robot* m_root;      // Root of the BST
     TREETYPE m_type;    // Type of tree (NONE, BST, AVL, SPLAY)
+    RobotPool* m_pool;  // Allocator for every node in this tree, shared with snapshots; nullptr after a move
+    RobotIndex* m_index;  // Dense ID index, or nullptr when disabled
+    mutable int m_tally[TYPECOUNT][STATECOUNT];  // Number of robots of each type and state
+    mutable bool m_tallyStale;  // Tallies must be recounted after a split, join or set operation
+    bool m_lazyDelete;  // remove() tombstones instead of unlinking
+    bool m_shared;      // Nodes may be shared with a snapshot, copy before writing
+    SwarmJournal* m_journal;  // Write-ahead journal, or nullptr when disabled
 
     // Private helper functions
-    Robot* insertHelper(Robot* root, Robot* newRobot);   // Helper for insertion
-    Robot* removeHelper(Robot* root, int id);            // Helper for removal
-    Robot* getMinNode(Robot* root) const;                // Helper to find min node
-    Robot* clone(Robot* root) const;                     // Deep copy helper
+    bool insertHelper(Robot* newRobot);                  // Helper for insertion
+    bool removeHelper(int id);                           // Helper for removal
+    bool tombstone(int id);                              // Mark a robot deleted in place
+    void revive(Robot* node, ROBOTTYPE type, STATE state);  // Reuse a tombstoned node
+    Robot* locate(int id) const;                         // Live robot with this ID, without splaying
+    void rebalancePath(RobotStack& path);                // Fix heights/balance up a search path
+    void replaceChild(Robot* parent, Robot* child);      // Relink child under parent or as root
+    Robot* clone(Robot* root);                           // Deep copy helper
+    RobotPool* pool();                                   // m_pool, created after a move left it null
+    void journal(int kind, int id, ROBOTTYPE type, STATE state);  // Log an OPKIND or a clear
+    void journalContents();                              // Log a clear and every live robot
+
+    // Snapshot helpers
+    explicit Swarm(Swarm* source);                       // Share source's nodes
+    Robot* own(Robot* node);                             // Node itself if unshared, else a private copy
+    Robot* ownPathTo(int id);                            // Copy shared nodes on the search path for id
+    Robot* search(int id) const;                         // Node with this ID, tombstoned or not
+    void addRef(Robot* node);                            // Count one more link to node
+    void dropTree(Robot* node);                          // Drop one link, freeing what becomes unused
+    void detach();                                       // Replace shared nodes with a private copy
+    void tally(const Robot* node, int delta);            // Adjust the type/state tally for a node
+    void clearTally();                                   // Zero every type/state tally
 
     // AVL tree balancing helpers
     Robot* balanceTree(Robot* node);                     // Balance the tree (for AVL)
     int getHeight(Robot* node) const;                    // Get node height
+    int getSize(Robot* node) const;                      // Get subtree size
+    int liveCount(Robot* node) const;                    // 1 for a live node, 0 for a tombstone
+    void updateSize(Robot* node);                        // Recompute subtree size from children
     int getBalance(Robot* node) const;                   // Get balance factor
     Robot* leftRotate(Robot* x);                         // Left rotation
     Robot* rightRotate(Robot* y);                        // Right rotation
 
-    // Splay tree helper
-    Robot* splay(Robot* root, int id);                   // Splay a node to the root
+    // Splay tree helpers
+    Robot* splay(Robot* root, int id);                   // Top-down splay of a node to the root
+    void splayInsert(int id, ROBOTTYPE type, STATE state);  // Insert in a single splay pass
+    void splayRemove(int id);                            // Remove in a single splay pass
+
+    // Split/join helpers, AVL join by rank (height)
+    explicit Swarm(TREETYPE type, RobotPool* pool);      // Empty swarm sharing a pool
+    void updateHeight(Robot* node);                      // Recompute height from children
+    Robot* joinTrees(Robot* left, Robot* mid, Robot* right);  // left < mid < right, O(height difference)
+    Robot* joinTrees(Robot* left, Robot* right);         // left < right, O(log n)
+    Robot* climb(RobotStack& path, Robot* sub, bool rightSide);  // Relink sub up a spine, rebalancing
+    Robot* splitTree(Robot* root, int id, Robot*& left, Robot*& right);  // Returns the node with id
+    void recountTally() const;                           // Rebuild the tallies with a full walk
 
-    // Helper for dumping tree (in-order traversal)
-    void dump(Robot* aBot) const;
+    // Set operation helpers
+    enum SetOp {SETUNION, SETINTERSECT, SETDIFFERENCE};
+    struct SetPiece {
+        Robot* m_tree;          // Part of this swarm, then the matching part of the result
+        Robot* m_spare;         // Preallocated nodes for robots copied from the other swarm
+        RobotStack m_garbage;   // Subtrees dropped from the result
+        long long m_lo;         // Lowest ID covered by the piece
+        long long m_hi;         // Highest ID covered by the piece
+    };
+    void applySetOp(const Swarm& other, SetOp op);
+    Robot* setOpHelper(Robot* tree, const FrozenSwarm& other, int slot,
+                       long long lo, long long hi, SetOp op, SetPiece& piece);
+
+    // Helpers for dumping and exporting the tree (in-order traversal)
+    void dump(Robot* aBot, ExportBuffer& out) const;
+    bool exportFormat(ExportBuffer& out, EXPORTFORMAT format) const;
 
     // Memory management helpers
-    void clearHelper(Robot* node);  // Recursively deallocate memory
+    void clearHelper(Robot* node);  // Release a subtree to the pool without recursion
+    void indexTree();               // Record every node of the tree in m_index
+
+    // Helpers to relink the existing nodes into a balanced tree without STL
+    void rebuildBalanced();                              // Rebalance the whole tree in O(n)
+    Robot* treeToVine(Robot* root, int& count);          // Flatten into a sorted list
+    Robot* buildBalanced(Robot*& list, int count);       // Build a balanced tree from a sorted list
+    Robot* sortVine(Robot*& list, int count);            // Stable merge sort of a list by ID
+    Robot* mergeVines(Robot* first, Robot* second, int& count); // Merge sorted lists, first wins ties
+    void mergeBatch(SwarmOp* const sorted[], int count); // Merge ID sorted ops into the flattened tree
+    void applyOp(SwarmOp* op);                           // One op of a small batch, one search
+};
+
+// Visit a contiguous ID range with an iterator, O(log n + k)
+template <class Visitor>
+void Swarm::forEachInRange(int lo, int hi, Visitor visit) const {
+    for (SwarmIterator it = lowerBound(lo); it != end() && it->getID() <= hi; ++it) {
+        visit(*it);
+    }
+}
+
+// FrozenSwarm class definition
+// Immutable snapshot of a Swarm for read-only phases. IDs are stored in
+// Eytzinger (BFS) order in a cache-line aligned array: slot k has children
+// 2k and 2k+1, so a search touches one predictable array instead of chasing
+// pointers, runs without data dependent branches and prefetches four levels
+// ahead. Types and states are packed one byte per slot alongside.
+// Slots run from 1 to size(); slot 0 means "no robot".
+class FrozenSwarm {
+public:
+    friend class Grader;
+    friend class Tester;
+
+    FrozenSwarm();
+    explicit FrozenSwarm(const Swarm& swarm);
+    FrozenSwarm(const FrozenSwarm& rhs);
+    ~FrozenSwarm();
+
+    const FrozenSwarm& operator=(const FrozenSwarm& rhs);
+
+    int size() const { return m_size; }
+
+    // Point lookup
+    bool find(int id, Robot& robot) const;   // Copy out the robot with this ID
+    bool contains(int id) const;
+
+    // Slot based search
+    int findSlot(int id) const;              // Slot of this ID, or 0 if absent
+    int lowerBound(int id) const;            // Slot of the smallest ID >= id, or 0 if none
+    void findBatch(const int ids[], int count, int slots[]) const;  // findSlot for many IDs
+
+    // Slot accessors
+    int getID(int slot) const { return m_ids[slot]; }
+    ROBOTTYPE getType(int slot) const { return static_cast<ROBOTTYPE>(m_info[slot] & 7); }
+    STATE getState(int slot) const { return static_cast<STATE>(m_info[slot] >> 3); }
+    int nextSlot(int slot) const;            // In-order successor, or 0 after the last robot
+
+    // Type/state tallies, counted when frozen - O(1)
+    int count(ROBOTTYPE type, STATE state) const { return m_tally[type][state]; }
+
+    // Call visit(id, type, state) for every robot with lo <= ID <= hi, in ID order
+    template <class Visitor>
+    void forEachInRange(int lo, int hi, Visitor visit) const;
+
+    // Mappable files - save() writes a 64-byte header (with the tallies)
+    // followed by the ID and info arrays exactly as they sit in memory.
+    // map() turns this snapshot into a read-only view of such a file through
+    // mmap: opening reads only the header page, nothing is parsed or
+    // allocated, and searches page in just the slots they touch. The file
+    // uses the host byte order, which the header records and map() checks.
+    bool save(const string& path) const;
+    bool map(const string& path);
+    bool isMapped() const { return m_mapping != nullptr; }
+
+private:
+    int* m_ids;               // IDs in Eytzinger order, 64-byte aligned, slot 0 unused
+    unsigned char* m_info;    // Type in bits 0-2, state in bit 3
+    int m_size;               // Number of robots
+    int m_levels;             // Depth of the implicit tree
+    int m_tally[TYPECOUNT][STATECOUNT];  // Number of robots of each type and state
+    void* m_mapping;          // Mapped file the arrays point into, or nullptr
+    size_t m_mappedLength;    // Length of the mapping
+
+    void allocate(int size);  // Allocate storage for size robots
+    void release();           // Free storage or unmap the file
+};
+
+// Visit a contiguous ID range: one descent, then in-order successor steps
+template <class Visitor>
+void FrozenSwarm::forEachInRange(int lo, int hi, Visitor visit) const {
+    for (int slot = lowerBound(lo); slot != 0 && m_ids[slot] <= hi; slot = nextSlot(slot)) {
+        visit(m_ids[slot], getType(slot), getState(slot));
+    }
+}
+
+// ConcurrentSwarm class definition
+// A swarm shared by one writer thread and any number of reader threads. The
+// writer edits a private Swarm, and publish() freezes it into a new
+// FrozenSwarm version that readers pick up through one atomic pointer.
+// Readers pin a version with a ReadGuard and search it without locks, and
+// nothing they touch is ever written, so writes never block reads.
+// Replaced versions are freed once no reader that could see them is still
+// pinned (epoch based reclamation).
+// Reads never splay. In SPLAY mode only the writer's own operations splay
+// its private tree; readers always search the frozen copy.
+class ConcurrentSwarm {
+public:
+    friend class Grader;
+    friend class Tester;
+
+    // Pins the current version for as long as the guard lives
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentSwarm& swarm);
+        ~ReadGuard();
+
+        const FrozenSwarm& operator*() const { return *m_version; }
+        const FrozenSwarm* operator->() const { return m_version; }
+
+    private:
+        const ConcurrentSwarm& m_swarm;
+        int m_slot;                      // Reader slot holding the pin
+        const FrozenSwarm* m_version;    // Version pinned at construction
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    ConcurrentSwarm();
+    explicit ConcurrentSwarm(TREETYPE type);
+    ~ConcurrentSwarm();  // No reader may be pinned
+
+    // Writer side - one thread only. Changes reach readers at publish().
+    void insert(const Robot& robot);
+    void remove(int id);
+    bool setState(int id, STATE state);
+    bool setRobotType(int id, ROBOTTYPE type);
+    void bulkLoad(const Robot robots[], int count);
+    void publish();   // O(n) freeze, then an O(1) swap for readers
+
+    // Reader side - any thread, lock-free, each call pins the current version.
+    // At most READERSLOTS reads and ReadGuards can be pinned at once; further
+    // readers wait, yielding, until a slot is released.
+    bool find(int id, Robot& robot) const;
+    bool contains(int id) const;
+    int size() const;
+
+private:
+    // A published snapshot, chained on the retired list once replaced
+    struct Version {
+        explicit Version(const Swarm& swarm) : m_frozen(swarm), m_retired(0), m_next(nullptr) {}
+        FrozenSwarm m_frozen;
+        unsigned long long m_retired;   // Epoch in which it was replaced
+        Version* m_next;
+    };
+
+    // One pinned reader, padded to its own cache line. Epoch 0 means idle.
+    struct alignas(64) ReaderSlot {
+        std::atomic<unsigned long long> m_epoch;
+        std::atomic<bool> m_claimed;
+    };
+
+    Swarm m_writer;                          // Writer's private tree
+    std::atomic<Version*> m_current;         // Version new readers pin
+    std::atomic<unsigned long long> m_epoch; // Bumped on every publish
+    mutable ReaderSlot m_slots[READERSLOTS];
+    Version* m_retired;                      // Replaced versions, newest first
+
+    int pin() const;                         // Claim a slot and announce the epoch
+    void unpin(int slot) const;              // Leave the slot idle
+    void reclaim();                          // Free versions no reader can see
+};
+
+// ShardedSwarm class definition
+// Swarm partitioned into shards that each own a contiguous slice of
+// MINID..MAXID. Every shard is a Swarm behind its own lock, so writers to
+// different ID ranges never wait on each other. Batches are grouped by shard
+// and run one task per shard group on the set operation thread pool.
+// Visiting the shards in order yields the robots in ID order.
+class ShardedSwarm {
+public:
+    friend class Grader;
+    friend class Tester;
+
+    ShardedSwarm();
+    explicit ShardedSwarm(TREETYPE type, int shards = SHARDCOUNT);
+    ~ShardedSwarm();
+
+    // Point operations - any thread, each locks one shard
+    void insert(const Robot& robot);
+    void remove(int id);
+    bool find(int id, Robot& robot);   // Copy out, the node may go once the lock drops
+    bool contains(int id);
+    bool setState(int id, STATE state);
+    bool setRobotType(int id, ROBOTTYPE type);
+
+    // Batched dispatch - each shard is locked once for its whole group
+    void insertBatch(const Robot robots[], int count);
+    void removeBatch(const int ids[], int count);
+
+    int size() const;                  // Sum of the shard sizes
+    int shardCount() const { return m_shardCount; }
+    int shardOf(int id) const;         // Shard owning this ID
+
+    // Call visit(robot) in ID order, holding one shard lock at a time.
+    // forEach also visits IDs outside MINID..MAXID, which live in the end
+    // shards. visit must not modify the ShardedSwarm.
+    template <class Visitor>
+    void forEach(Visitor visit) const;
+    template <class Visitor>
+    void forEachInRange(int lo, int hi, Visitor visit) const;
+
+private:
+    // One shard, padded so neighbouring locks do not share a cache line
+    struct alignas(64) Shard {
+        explicit Shard(TREETYPE type) : m_swarm(type) {}
+        mutable std::mutex m_lock;
+        Swarm m_swarm;
+    };
+
+    Shard** m_shards;
+    int m_shardCount;
+
+    ShardedSwarm(const ShardedSwarm&) = delete;
+    ShardedSwarm& operator=(const ShardedSwarm&) = delete;
+};
+
+template <class Visitor>
+void ShardedSwarm::forEach(Visitor visit) const {
+    forEachInRange(INT_MIN, INT_MAX, visit);
+}
+
+// Visit the shards that overlap [lo, hi] in order
+template <class Visitor>
+void ShardedSwarm::forEachInRange(int lo, int hi, Visitor visit) const {
+    if (lo > hi) {
+        return;
+    }
+    for (int i = shardOf(lo); i <= shardOf(hi); i++) {
+        std::lock_guard<std::mutex> lock(m_shards[i]->m_lock);
+        m_shards[i]->m_swarm.forEachInRange(lo, hi, visit);
+    }
+}
+
+// CompactSwarm class definition
+// Swarm with the same tree operations that stores its nodes in one contiguous
+// array linked by 32-bit indices instead of individually placed Robots. A node
+// is 16 bytes, so a full MINID..MAXID swarm fits in about 1.4 MB. Index 0 is
+// the null link, and its slot doubles as the header of the top-down splay.
+class CompactSwarm {
+public:
+    friend class Grader;
+    friend class Tester;
+
+    // Constructors, Destructor
+    CompactSwarm();
+    CompactSwarm(TREETYPE type);
+    CompactSwarm(const CompactSwarm& rhs);
+    ~CompactSwarm();
+
+    // Overloaded assignment operator
+    const CompactSwarm& operator=(const CompactSwarm& rhs);
+
+    // Basic tree operations
+    void insert(const Robot& robot);
+    void remove(int id);
+    void clear();
+    TREETYPE getType() const;
+    void setType(TREETYPE type);
+
+    // Point lookup - copies the robot out since nodes are not Robot objects
+    bool find(int id, Robot& robot);
+    bool contains(int id);
+
+    // Tree printing (in-order traversal)
+    void dumpTree() const;
+
+private:
+    // Packed node: height in the low 24 bits of m_meta, type and state in the top byte
+    struct Node {
+        unsigned int m_left;    // Index of the left child, 0 for none
+        unsigned int m_right;   // Index of the right child, 0 for none
+        int m_id;               // Unique ID for the robot
+        unsigned int m_meta;    // Height, type and state
+    };
+
+    Node* m_nodes;              // Node array, slot 0 is reserved
+    unsigned int m_capacity;    // Slots in m_nodes
+    unsigned int m_used;        // Slots handed out so far, including slot 0
+    unsigned int m_freeList;    // Released slots, linked through m_right
+    unsigned int m_root;        // Index of the root, 0 when empty
+    TREETYPE m_type;            // Type of tree (NONE, BST, AVL, SPLAY)
+
+    // Node storage helpers, allocate() may move m_nodes so hold indices only
+    unsigned int allocate(const Robot& robot);
+    void release(unsigned int node);
+
+    // Packed field helpers
+    int getHeight(unsigned int node) const;
+    void setHeight(unsigned int node, int height);
+    void updateHeight(unsigned int node);
+    ROBOTTYPE getRobotType(unsigned int node) const;
+    STATE getState(unsigned int node) const;
 
-    // Helper to rebuild the tree as AVL without STL
-    void rebuildAVL(Robot* node);
+    // Tree helpers, mirroring Swarm's
+    unsigned int findNode(int id);
+    void replaceChild(unsigned int parent, unsigned int child);
+    void rebalancePath(NodeStack<unsigned int>& path);
+    unsigned int balanceTree(unsigned int node);
+    unsigned int leftRotate(unsigned int x);
+    unsigned int rightRotate(unsigned int y);
+    unsigned int splay(unsigned int root, int id);
+    void splayInsert(const Robot& robot);
+    void splayRemove(int id);
+    void rebuildBalanced();
+    unsigned int treeToVine(unsigned int root, unsigned int& count);
+    unsigned int buildBalanced(unsigned int& list, unsigned int count);
 };
 
 #endif
\ No newline at end of file